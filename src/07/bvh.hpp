@@ -83,23 +83,25 @@ public:
             size_t N1 = N - N0;
             children[0] = new BVHNode;
             children[1] = new BVHNode;
+            // large subtrees are built in parallel when called from within
+            // an OpenMP parallel region; the subsets are disjoint
+            #pragma omp task if(N0 > 4096) default(shared)
             children[0]->build(surfaces, aabbs, subset, areas0, areas1, I0, N0);
             children[1]->build(surfaces, aabbs, subset, areas0, areas1, I1, N1);
+            #pragma omp taskwait
             isLeaf = false;
         }
     }
 
-    static const BVHNode* buildBVH(const std::vector<std::unique_ptr<Surface>>& surfaces, float t0, float t1)
+    static const BVHNode* buildBVH(const std::vector<std::unique_ptr<Surface>>& surfaces,
+            const std::vector<AABB>& aabbs, float t0, float t1)
     {
         fprintf(stderr, "Building bounding volume hierarchy for %zu surfaces for %.3fs-%.3fs... ",
                 surfaces.size(), t0, t1);
         BVHNode* rootNode = new BVHNode;
-        std::vector<AABB> aabbs(surfaces.size());
         std::vector<unsigned int> subset(surfaces.size());
-        for (size_t i = 0; i < surfaces.size(); i++) {
-            aabbs[i] = surfaces[i]->aabb(t0, t1);
+        for (size_t i = 0; i < surfaces.size(); i++)
             subset[i] = i;
-        }
         std::vector<float> areas0(surfaces.size());
         std::vector<float> areas1(surfaces.size());
         rootNode->build(surfaces, aabbs, subset, areas0, areas1, 0, subset.size());
@@ -137,6 +139,7 @@ class BVHTreeLinear : public Surface
 public:
     static const size_t maxTreeDepth = 128;
     std::vector<BVHNodeLinear> nodes;
+    std::vector<AABB> surfaceAABBs; // the surface AABBs the tree was built for
 
     BVHTreeLinear()
     {
@@ -158,9 +161,27 @@ public:
         return myOffset;
     }
 
+    static bool equal(const AABB& a, const AABB& b)
+    {
+        for (int i = 0; i < 3; i++)
+            if (a.lo[i] != b.lo[i] || a.hi[i] != b.hi[i])
+                return false;
+        return true;
+    }
+
+    // Build the tree for the time interval [t0,t1]. If no surface AABB changed
+    // since the last build (e.g. for a static scene), the tree is kept.
     void build(const std::vector<std::unique_ptr<Surface>>& surfaces, float t0, float t1)
     {
-        const BVHNode* root = BVHNode::buildBVH(surfaces, t0, t1);
+        std::vector<AABB> aabbs(surfaces.size());
+        for (size_t i = 0; i < surfaces.size(); i++)
+            aabbs[i] = surfaces[i]->aabb(t0, t1);
+        if (!nodes.empty() && aabbs.size() == surfaceAABBs.size()
+                && std::equal(aabbs.begin(), aabbs.end(), surfaceAABBs.begin(), equal)) {
+            fprintf(stderr, "Bounding volume hierarchy is still valid for %.3fs-%.3fs\n", t0, t1);
+            return;
+        }
+        const BVHNode* root = BVHNode::buildBVH(surfaces, aabbs, t0, t1);
         size_t nodeCount, maxDepth;
         root->measure(nodeCount, maxDepth);
         if (maxDepth > maxTreeDepth) {
@@ -172,6 +193,7 @@ public:
         size_t offset = 0;
         flattenBVH(root, &offset);
         delete root;
+        surfaceAABBs = std::move(aabbs);
         fprintf(stderr, "done.\n");
     }
 
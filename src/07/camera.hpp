@@ -24,7 +24,7 @@ public:
     {
     }
 
-    Ray getRay(float p, float q, float t0, float t1, Prng& prng)
+    Ray getRay(float p, float q, float t0, float t1, Prng& prng) const
     {
         // get origin O and direction D in camera space
         vec3 P = vec3(mix(l, r, p), mix(b, t, q), -1.0f);
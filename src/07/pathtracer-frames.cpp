@@ -1,5 +1,14 @@
 #include <vector>
 #include <limits>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #include "math.hpp"
 #include "ray.hpp"
@@ -31,7 +40,7 @@
 #include "stb_image.h"
 
 // Compute the radiance for one path sample
-vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
+vec3 pathSample(const BVHTreeLinear& bvh, const Ray& startRay, Prng& prng)
 {
     const float MinHitDistance = 0.0001f;
     const float MaxHitDistance = std::numeric_limits<float>::max();
@@ -41,7 +50,9 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
     vec3 throughput(1.0f);
     Ray ray = startRay;
     for (int segment = 0; segment < MaxPathSegments; segment++) {
-        HitRecord hr = scene.bvh.hit(ray, MinHitDistance, MaxHitDistance);
+        // bounce 0 is used by the camera
+        prng.setBounce(segment + 1);
+        HitRecord hr = bvh.hit(ray, MinHitDistance, MaxHitDistance);
         if (!hr.haveHit)
             break;
         // scatter the ray at the hit point
@@ -176,64 +187,261 @@ void buildScene(Scene& scene)
     }
 }
 
+// Render a frame for the time interval [t0,t1] with the given BVH into img.
+// The rows are rendered by OpenMP tasks, so this must be called from within
+// a parallel region to use all threads; it returns when all rows are done.
+void renderFrame(const BVHTreeLinear& bvh, const Camera& camera, int width, int height, int spp,
+        float t0, float t1, std::vector<vec3>& img)
+{
+    #pragma omp taskloop grainsize(1) default(shared)
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int pixel = y * width + x;
+            // Initialize pixel
+            img[pixel] = vec3(0.0f);
+            // Add samples
+            for (int i = 0; i < spp; i++) {
+                // Random number generator per pixel and sample: the results do not
+                // depend on which thread or process computes which samples
+                Prng prng(42, pixel, i);
+                float p = (x + prng.in01()) / width;
+                float q = (y + prng.in01()) / height;
+                Ray ray = camera.getRay(p, q, t0, t1, prng);
+                img[pixel] += pathSample(bvh, ray, prng);
+            }
+            // Normalize
+            img[pixel] /= spp;
+        }
+    }
+}
+
+std::string frameFileName(int frame)
+{
+    return "frame-" + std::to_string(frame) + ".ppm";
+}
+
+// Save a frame; write to a temporary file first so that an interrupted
+// process never leaves an incomplete frame behind
+bool saveFrame(const std::string& fileName, const std::vector<vec3>& img, int width, int height)
+{
+    if (!saveImageAsPPM(fileName + ".tmp", to8Bit(img), width, height)
+            || std::rename((fileName + ".tmp").c_str(), fileName.c_str()) != 0) {
+        fprintf(stderr, "Cannot write %s\n", fileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Render the frames in a pipeline: while frame k is rendered, the BVH for
+// frame k+1 is built and frame k-1 is tone mapped and saved by other
+// threads of the same OpenMP thread pool. BVHs and images are double
+// buffered for that. The BVH of a frame is only rebuilt if the surfaces
+// moved since the BVH was last built.
+bool renderFramesPipelined(const Scene& scene, const Camera& camera, int width, int height, int spp,
+        float frameDuration, const std::vector<int>& frameList)
+{
+    BVHTreeLinear bvhs[2];
+    std::vector<vec3> imgs[2] = { std::vector<vec3>(width * height), std::vector<vec3>(width * height) };
+    bool ok = true;
+    auto frameStart = std::chrono::steady_clock::now();
+    #pragma omp parallel
+    #pragma omp single
+    {
+        size_t n = frameList.size();
+        if (n > 0)
+            bvhs[0].build(scene.surfaces, frameList[0] * frameDuration, (frameList[0] + 1) * frameDuration);
+        for (size_t k = 0; k < n; k++) {
+            int frame = frameList[k];
+            float t0 = frame * frameDuration;
+            float t1 = t0 + frameDuration;
+            if (k + 1 < n) {
+                #pragma omp task default(shared) firstprivate(k)
+                bvhs[(k + 1) % 2].build(scene.surfaces, frameList[k + 1] * frameDuration,
+                        (frameList[k + 1] + 1) * frameDuration);
+            }
+            if (k > 0) {
+                #pragma omp task default(shared) firstprivate(k)
+                if (!saveFrame(frameFileName(frameList[k - 1]), imgs[(k - 1) % 2], width, height)) {
+                    #pragma omp atomic write
+                    ok = false;
+                }
+            }
+            renderFrame(bvhs[k % 2], camera, width, height, spp, t0, t1, imgs[k % 2]);
+            #pragma omp taskwait
+            auto now = std::chrono::steady_clock::now();
+            fprintf(stderr, "Frame %d done after %.2fs\n", frame,
+                    std::chrono::duration<double>(now - frameStart).count());
+            frameStart = now;
+        }
+        if (n > 0 && !saveFrame(frameFileName(frameList[n - 1]), imgs[(n - 1) % 2], width, height))
+            ok = false;
+    }
+    return ok;
+}
+
+// Render several frames concurrently: each frame in flight has its own slot
+// with BVH and image, and builds, renders, and saves in one task. Frames using
+// the same slot are serialized by task dependencies. The threads are not
+// partitioned between the frames; they take row tasks of whichever frame has
+// work left, which balances the load best.
+bool renderFramesConcurrently(const Scene& scene, const Camera& camera, int width, int height, int spp,
+        float frameDuration, const std::vector<int>& frameList, int concurrentFrames)
+{
+    std::vector<BVHTreeLinear> slotBvhs(concurrentFrames);
+    std::vector<std::vector<vec3>> slotImgs(concurrentFrames, std::vector<vec3>(width * height));
+    std::vector<char> slotTokens(concurrentFrames);
+    bool ok = true;
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for (size_t k = 0; k < frameList.size(); k++) {
+            int slot = k % concurrentFrames;
+            #pragma omp task default(shared) firstprivate(k, slot) depend(inout: slotTokens.data()[slot])
+            {
+                int frame = frameList[k];
+                float t0 = frame * frameDuration;
+                float t1 = t0 + frameDuration;
+                auto start = std::chrono::steady_clock::now();
+                slotBvhs[slot].build(scene.surfaces, t0, t1);
+                renderFrame(slotBvhs[slot], camera, width, height, spp, t0, t1, slotImgs[slot]);
+                if (!saveFrame(frameFileName(frame), slotImgs[slot], width, height)) {
+                    #pragma omp atomic write
+                    ok = false;
+                }
+                fprintf(stderr, "Frame %d done after %.2fs\n", frame,
+                        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+        }
+    }
+    return ok;
+}
+
+// Choose how many frames to render concurrently. Large frames are best rendered
+// one at a time with the pixels distributed to all threads, but if there is
+// little work per frame and thread, the serial parts of each frame and the
+// synchronization at its end dominate; then several frames are rendered at the
+// same time so that each thread gets enough work.
+int autoConcurrentFrames(int width, int height, int spp, int threads, int frames)
+{
+    const double minSamplesPerThread = 1 << 20;
+    double samplesPerFrame = double(width) * height * spp;
+    int concurrentFrames = std::ceil(threads * minSamplesPerThread / samplesPerFrame);
+    return std::clamp(concurrentFrames, 1, std::max(1, std::min(threads, frames)));
+}
+
+// Parse a frame list such as "0-99", "0-99:4" (every 4th frame starting
+// with 0), or "1,5,10-20:2". Returns false if the list is invalid or
+// contains frames outside of [0,frames-1].
+bool parseFrameList(const std::string& list, int frames, std::vector<int>& result)
+{
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string item = list.substr(start, end - start);
+        int first, last, stride = 1;
+        char dummy;
+        if (std::sscanf(item.c_str(), "%d-%d:%d%c", &first, &last, &stride, &dummy) != 3
+                && std::sscanf(item.c_str(), "%d-%d%c", &first, &last, &dummy) != 2) {
+            if (std::sscanf(item.c_str(), "%d%c", &first, &dummy) != 1)
+                return false;
+            last = first;
+        }
+        if (first < 0 || last >= frames || first > last || stride < 1)
+            return false;
+        for (int f = first; f <= last; f += stride)
+            result.push_back(f);
+        start = end + 1;
+    }
+    return !result.empty();
+}
+
+bool fileExists(const std::string& fileName)
+{
+    FILE* f = std::fopen(fileName.c_str(), "rb");
+    if (f)
+        std::fclose(f);
+    return f;
+}
+
 // Path Tracing main loops
+// Usage: pathtracer-frames                  render all frames
+//        pathtracer-frames <frame>          render only the given frame
+//        pathtracer-frames --frames <list>  render the frames in the list (see
+//                                           parseFrameList), skipping frames
+//                                           whose output file already exists;
+//                                           e.g. worker k of n uses k-249:n
 int main(int argc, char* argv[])
 {
     // The image: RGB values per pixel, floating point
     int width = 1920 / 4;
     int height = 1080 / 4;
-    std::vector<vec3> img(width * height);
     int spp = 2048 / 16;
+    int concurrentFrames = 0; // number of frames rendered at the same time; 0 means automatic
 
     // The frame setup
     float fps = 25.0f;
     float frameDuration = 1.0f / fps;
     float totalDuration = 10.0f;
     int frames = totalDuration / frameDuration;
-    int myFrame = -1;
-    if (argc == 2) {
-        myFrame = std::atoi(argv[1]);
+    std::vector<int> frameList;
+    bool skipExisting = false;
+    if (argc == 3 && std::string(argv[1]) == "--frames") {
+        if (!parseFrameList(argv[2], frames, frameList)) {
+            fprintf(stderr, "Invalid frame list %s (frames are 0-%d)\n", argv[2], frames - 1);
+            return 1;
+        }
+        skipExisting = true;
+        fprintf(stderr, "Rendering %zu frames\n", frameList.size());
+    } else if (argc == 2) {
+        int myFrame = std::atoi(argv[1]);
+        if (myFrame < 0 || myFrame >= frames) {
+            fprintf(stderr, "Invalid frame %d (frames are 0-%d)\n", myFrame, frames - 1);
+            return 1;
+        }
         fprintf(stderr, "Rendering only frame %d\n", myFrame);
+        frameList.push_back(myFrame);
+    } else {
+        for (int frame = 0; frame < frames; frame++)
+            frameList.push_back(frame);
     }
 
-    // Camera and scene
+    // Camera and scene; these are set up only once for all frames
     Scene scene;
     buildScene(scene);
     Camera camera(radians(50.0f), float(width) / height);
 
-    // Loop over the frames
-    for (int frame = 0; frame < frames; frame++) {
-        if (myFrame >= 0 && frame != myFrame)
-            continue;
-
-        float t0 = frame * frameDuration;
-        float t1 = t0 + frameDuration;
-        scene.buildBVH(t0, t1);
-
-        // Loop over pixels in the image
-        #pragma omp parallel for schedule(dynamic)
-        for (int pixel = 0; pixel < width * height; pixel++) {
-            // Radom number generator per pixel (so that it works with parallel threads)
-            Prng prng(pixel + 42);
-            // Get pixel x, y from linear index
-            int y = pixel / width;
-            int x = pixel % width;
-            // Initialize pixel
-            img[y * width + x] = vec3(0.0f);
-            // Add samples
-            for (int i = 0; i < spp; i++) {
-                float p = (x + prng.in01()) / width;
-                float q = (y + prng.in01()) / height;
-                Ray ray = camera.getRay(p, q, t0, t1, prng);
-                img[y * width + x] += pathSample(scene, ray, prng);
-            }
-            // Normalize
-            img[y * width + x] /= spp;
+    // Skip frames that were already rendered
+    if (skipExisting) {
+        std::vector<int> remainingFrames;
+        for (int frame : frameList) {
+            if (fileExists(frameFileName(frame)))
+                fprintf(stderr, "Skipping frame %d: %s exists\n", frame, frameFileName(frame).c_str());
+            else
+                remainingFrames.push_back(frame);
         }
+        frameList = remainingFrames;
+    }
+
+    // Decide between pixel-level and frame-level parallelism
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (concurrentFrames <= 0)
+        concurrentFrames = autoConcurrentFrames(width, height, spp, threads, frameList.size());
 
-        // Save the frame
-        saveImageAsPPM("frame-" + std::to_string(frame) + ".ppm", to8Bit(img), width, height);
+    bool ok;
+    if (concurrentFrames == 1) {
+        ok = renderFramesPipelined(scene, camera, width, height, spp, frameDuration, frameList);
+    } else {
+        fprintf(stderr, "Rendering %d frames concurrently\n", concurrentFrames);
+        ok = renderFramesConcurrently(scene, camera, width, height, spp, frameDuration, frameList,
+                concurrentFrames);
     }
+    if (!ok)
+        return 1;
 
     // Create a high quality video:
     // ffmpeg -i frame-%d.ppm -c:v libx265 -preset veryslow -crf 20 -vf format=yuv420p video.mp4
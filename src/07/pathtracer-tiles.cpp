@@ -1,5 +1,8 @@
 #include <vector>
 #include <limits>
+#include <string>
+
+#include <poll.h>
 
 #include "math.hpp"
 #include "ray.hpp"
@@ -24,12 +27,31 @@
 #include "color.hpp"
 #include "bvh.hpp"
 #include "imgsave.hpp"
+#include "tilenet.hpp"
+#include "samplerange.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// Set up the scene and the animation of its camera; returns the camera
+// animation, or nullptr on failure. Workers and all other modes use this and
+// sceneCamera(), so that every process renders the same view.
+const Animation* setupScene(Scene& scene)
+{
+    if (!importIntoScene(scene, "CornellBox-Original.obj"))
+        return nullptr;
+    scene.buildBVH(0.0f, 0.0f);
+    return scene.take(new AnimationConstant(Transformation(vec3(0.0f, 1.0f, 3.2f), vec3(0.0f, 1.0f, -1.0f))));
+}
+
+// The camera for an image of the given size
+Camera sceneCamera(const Animation* cameraAnimation, int width, int height)
+{
+    return Camera(radians(50.0f), float(width) / height, cameraAnimation);
+}
+
 // Compute the radiance for one path sample
 vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
 {
@@ -41,6 +63,8 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
     vec3 throughput(1.0f);
     Ray ray = startRay;
     for (int segment = 0; segment < MaxPathSegments; segment++) {
+        // bounce 0 is used by the camera
+        prng.setBounce(segment + 1);
         HitRecord hr = scene.bvh.hit(ray, MinHitDistance, MaxHitDistance);
         if (!hr.haveHit)
             break;
@@ -60,7 +84,104 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
     return radiance;
 }
 
+// Render the tile at (x0,y0) with size w x h of an image with the given size,
+// using the samples with indices firstSample to firstSample + spp - 1
+std::vector<vec3> renderTile(const Scene& scene, const Camera& camera,
+        int width, int height, int firstSample, int spp, int x0, int y0, int w, int h)
+{
+    std::vector<vec3> tileImg(w * h);
+    #pragma omp parallel for schedule(dynamic)
+    for (int tilePixel = 0; tilePixel < w * h; tilePixel++) {
+        // Get pixel x, y from linear index
+        int x = x0 + tilePixel % w;
+        int y = y0 + tilePixel / w;
+        int pixel = y * width + x;
+        // Add samples
+        vec3 sum(0.0f);
+        for (int i = firstSample; i < firstSample + spp; i++) {
+            // Random number generator per pixel and sample: the results do not
+            // depend on which thread or process computes which samples
+            Prng prng(42, pixel, i);
+            float p = (x + prng.in01()) / width;
+            float q = (y + prng.in01()) / height;
+            Ray ray = camera.getRay(p, q, 0.0f, 0.0f, prng);
+            sum += pathSample(scene, ray, prng);
+        }
+        // Normalize
+        tileImg[tilePixel] = sum / spp;
+    }
+    return tileImg;
+}
+
+// Worker mode: get tiles from the coordinator, render them, and send them back
+int worker(const Scene& scene, const Animation* cameraAnimation, const std::string& address)
+{
+    int fd = tileSocket(address, false);
+    if (fd < 0)
+        return 1;
+    TileMessage msg(TileRequest);
+    if (!writeFully(fd, &msg, sizeof(msg))) {
+        fprintf(stderr, "Lost connection to coordinator\n");
+        return 1;
+    }
+    int tiles = 0;
+    for (;;) {
+        if (!readFully(fd, &msg, sizeof(msg))) {
+            fprintf(stderr, "Lost connection to coordinator\n");
+            return 1;
+        }
+        if (msg.type == TileDone)
+            break;
+        if (msg.type != TileAssignment) {
+            fprintf(stderr, "Invalid message from coordinator\n");
+            return 1;
+        }
+        if (!validAssignment(msg)) {
+            fprintf(stderr, "Invalid tile assignment from coordinator\n");
+            return 1;
+        }
+        Camera camera = sceneCamera(cameraAnimation, msg.imageWidth, msg.imageHeight);
+        fprintf(stderr, "Rendering tile %d (%dx%d at %d,%d)\n", msg.tile, msg.width, msg.height, msg.x, msg.y);
+        std::vector<vec3> tileImg = renderTile(scene, camera, msg.imageWidth, msg.imageHeight,
+                0, msg.spp, msg.x, msg.y, msg.width, msg.height);
+        // the coordinator may already have the tile from another worker and be
+        // done; anything else that arrives now is an error
+        pollfd p = { fd, POLLIN, 0 };
+        if (poll(&p, 1, 0) > 0) {
+            if (!readFully(fd, &msg, sizeof(msg))) {
+                fprintf(stderr, "Lost connection to coordinator\n");
+                return 1;
+            }
+            if (msg.type != TileDone) {
+                fprintf(stderr, "Invalid message from coordinator\n");
+                return 1;
+            }
+            break;
+        }
+        msg.type = TileResult;
+        msg.checksum = tileChecksum(tileImg);
+        if (!writeFully(fd, &msg, sizeof(msg))
+                || !writeFully(fd, tileImg.data(), tileImg.size() * sizeof(vec3))) {
+            fprintf(stderr, "Lost connection to coordinator\n");
+            return 1;
+        }
+        tiles++;
+    }
+    close(fd);
+    fprintf(stderr, "Done after %d tiles\n", tiles);
+    return 0;
+}
+
 // Path Tracing main loops
+// Usage: pathtracer-tiles                  render the complete image
+//        pathtracer-tiles <tile>           render only the given tile into tile-<tile>.raw
+//        pathtracer-tiles --worker <addr>  get tiles from the coordinator at the given
+//                                          address, see tile-composer
+//        pathtracer-tiles --samples <first> <count>
+//                                          render the complete image with only the
+//                                          samples first to first + count - 1 into
+//                                          samples-<first>-<count>.pfm; merge such
+//                                          files with tile-composer --merge
 int main(int argc, char* argv[])
 {
     // The image: RGB values per pixel, floating point
@@ -69,74 +190,65 @@ int main(int argc, char* argv[])
     std::vector<vec3> img(width * height);
     int spp = 8192;
 
-    // Tile configuration
-    int tileSize = 64;
-    int tilesX = width / tileSize;
-    int tilesY = height / tileSize;
-    int myTileIndex = -1;
-    int myTileX = -1;
-    int myTileY = -1;
-    if (argc == 2) {
-        myTileIndex = std::atoi(argv[1]);
-        myTileY = myTileIndex / tilesX;
-        myTileX = myTileIndex % tilesX;
-        fprintf(stderr, "Rendering only tile %d (%d,%d)\n",
-                myTileIndex, myTileX, myTileY);
-    }
-
     // Camera and scene
     Scene scene;
-    if (!importIntoScene(scene, "CornellBox-Original.obj"))
+    const Animation* cameraAnimation = setupScene(scene);
+    if (!cameraAnimation)
         return 1;
-    scene.buildBVH(0.0f, 0.0f);
-    AnimationConstant camAnim(Transformation(vec3(0.0f, 1.0f, 3.2f), vec3(0.0f, 1.0f, -1.0f)));
-    Camera camera(radians(50.0f), float(width) / height, &camAnim);
 
-    // Loop over pixels in the image
-    #pragma omp parallel for schedule(dynamic)
-    for (int pixel = 0; pixel < width * height; pixel++) {
-        // Radom number generator per pixel (so that it works with parallel threads)
-        Prng prng(pixel + 42);
-        // Get pixel x, y from linear index
-        int y = pixel / width;
-        int x = pixel % width;
-        // Skip pixels outside of our tile
-        if (myTileIndex >= 0) {
-            if (y < myTileY * tileSize || y >= (myTileY + 1) * tileSize
-                    || x < myTileX * tileSize || x >+ (myTileX + 1) * tileSize) {
-                continue;
-            }
+    if (argc == 3 && std::string(argv[1]) == "--worker")
+        return worker(scene, cameraAnimation, argv[2]);
+
+    Camera camera = sceneCamera(cameraAnimation, width, height);
+
+    // Render a range of samples, with the sample count in a separate file
+    if (argc == 4 && std::string(argv[1]) == "--samples") {
+        int firstSample = std::atoi(argv[2]);
+        int sampleCount = std::atoi(argv[3]);
+        if (firstSample < 0 || sampleCount <= 0) {
+            fprintf(stderr, "Invalid sample range\n");
+            return 1;
         }
-        // Initialize pixel
-        img[y * width + x] = vec3(0.0f);
-        // Add samples
-        for (int i = 0; i < spp; i++) {
-            float p = (x + prng.in01()) / width;
-            float q = (y + prng.in01()) / height;
-            Ray ray = camera.getRay(p, q, 0.0f, 0.0f, prng);
-            img[y * width + x] += pathSample(scene, ray, prng);
+        fprintf(stderr, "Rendering samples %d to %d\n", firstSample, firstSample + sampleCount - 1);
+        img = renderTile(scene, camera, width, height, firstSample, sampleCount, 0, 0, width, height);
+        std::string baseName = "samples-" + std::to_string(firstSample) + "-" + std::to_string(sampleCount);
+        if (!saveImageAsPfm(baseName + ".pfm", img, width, height)
+                || !saveSampleRange(baseName + ".pfm", firstSample, sampleCount)) {
+            fprintf(stderr, "Cannot write %s.pfm\n", baseName.c_str());
+            return 1;
         }
-        // Normalize
-        img[y * width + x] /= spp;
+        return 0;
     }
 
-    // Save the HDR image, or just the tile
-    if (myTileIndex < 0) {
-        saveImageAsPfm("image.pfm", img, width, height);
-        uniformRationalQuantization(img, 250.0f, 32.0f);
-        saveImageAsPPM("image.ppm", to8Bit(img), width, height);
-    } else {
-        std::ofstream ofs("tile-" + std::to_string(myTileIndex) + ".raw", std::ofstream::binary);
-        for (int ty = 0; ty < tileSize; ty++) {
-            int y = myTileY * tileSize + ty;
-            int x = myTileX * tileSize;
-            ofs.write(reinterpret_cast<const char*>(img.data())
-                    + (y * width + x) * sizeof(vec3),
-                    tileSize * sizeof(vec3));
+    // Tile configuration
+    int tileSize = 64;
+    int tilesX = width / tileSize;
+    int tilesY = height / tileSize;
+    if (argc == 2) {
+        int myTileIndex = std::atoi(argv[1]);
+        if (myTileIndex < 0 || myTileIndex >= tilesX * tilesY) {
+            fprintf(stderr, "Invalid tile %d\n", myTileIndex);
+            return 1;
         }
+        int myTileY = myTileIndex / tilesX;
+        int myTileX = myTileIndex % tilesX;
+        fprintf(stderr, "Rendering only tile %d (%d,%d)\n",
+                myTileIndex, myTileX, myTileY);
+        std::vector<vec3> tileImg = renderTile(scene, camera, width, height, 0, spp,
+                myTileX * tileSize, myTileY * tileSize, tileSize, tileSize);
+        // Save just the tile
+        std::ofstream ofs("tile-" + std::to_string(myTileIndex) + ".raw", std::ofstream::binary);
+        ofs.write(reinterpret_cast<const char*>(tileImg.data()), tileImg.size() * sizeof(vec3));
         ofs.flush();
         ofs.close();
+        return 0;
     }
 
+    // Render and save the HDR image
+    img = renderTile(scene, camera, width, height, 0, spp, 0, 0, width, height);
+    saveImageAsPfm("image.pfm", img, width, height);
+    uniformRationalQuantization(img, 250.0f, 32.0f);
+    saveImageAsPPM("image.ppm", to8Bit(img), width, height);
+
     return 0;
 }
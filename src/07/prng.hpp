@@ -1,23 +1,70 @@
 #pragma once
 
-#include <random>
+#include <cstdint>
 
 #include "math.hpp"
 
+// Counter-based pseudo random number generator (Philox4x32-10, see
+// "Parallel Random Numbers: As Easy as 1, 2, 3" by Salmon et al., SC 2011).
+// A random number is a function of a key (the seed) and a counter
+// (pixel, sample, bounce, dimension), so a generator is cheap to create and
+// the results do not depend on how the work is partitioned.
 class Prng
 {
 public:
-    std::mt19937_64 generator;
-    std::uniform_real_distribution<float> distribution;
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t block[4];
+    uint32_t dimension;
 
-    Prng(unsigned long seed) : generator(seed), distribution(0.0f, 1.0f)
+    Prng(uint64_t seed, uint32_t pixel = 0, uint32_t sample = 0, uint32_t bounce = 0) :
+        key { uint32_t(seed), uint32_t(seed >> 32) },
+        counter { pixel, sample, bounce, 0 },
+        dimension(0)
     {
     }
 
+    static void philox(const uint32_t ctr[4], const uint32_t k[2], uint32_t result[4])
+    {
+        uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+        uint32_t k0 = k[0], k1 = k[1];
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+            uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+            c0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+            c1 = uint32_t(p1);
+            c2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+            c3 = uint32_t(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        result[0] = c0;
+        result[1] = c1;
+        result[2] = c2;
+        result[3] = c3;
+    }
+
+    static float toFloat(uint32_t x)
+    {
+        return (x >> 8) * 0x1p-24f;
+    }
+
+    // start a new bounce: the following numbers depend on the bounce, not on
+    // how many numbers were used before
+    void setBounce(uint32_t bounce)
+    {
+        counter[2] = bounce;
+        dimension = 0;
+    }
+
     // return random number uniformly distributed in [0,1)
     float in01()
     {
-        return distribution(generator);
+        if (dimension % 4 == 0) {
+            counter[3] = dimension / 4;
+            philox(counter, key, block);
+        }
+        return toFloat(block[dimension++ % 4]);
     }
 
     // return random point uniformly distributed in the unit sphere
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+
+// Partial renderings: images rendered with only a range of the sample indices
+// of each pixel. Since the random numbers only depend on pixel and sample
+// index, partial renderings of disjoint ranges can be merged into the image
+// that one process would have computed, by weighting with the sample counts.
+// The range is stored in a small text file next to the image, named
+// <image>.samples, containing "samples <first> <count>".
+
+inline bool saveSampleRange(const std::string& imageFileName, int firstSample, int sampleCount)
+{
+    FILE* f = fopen((imageFileName + ".samples").c_str(), "w");
+    if (!f)
+        return false;
+    bool ok = fprintf(f, "samples %d %d\n", firstSample, sampleCount) > 0;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+inline bool loadSampleRange(const std::string& imageFileName, int& firstSample, int& sampleCount)
+{
+    FILE* f = fopen((imageFileName + ".samples").c_str(), "r");
+    if (!f)
+        return false;
+    bool ok = fscanf(f, "samples %d %d", &firstSample, &sampleCount) == 2 && sampleCount > 0;
+    fclose(f);
+    return ok;
+}
@@ -1,24 +1,316 @@
 #include <vector>
+#include <deque>
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <fcntl.h>
 
 #include "color.hpp"
 #include "math.hpp"
 #include "imgsave.hpp"
+#include "tilenet.hpp"
+#include "samplerange.hpp"
+
+// Postprocess and save image; the files are written with a temporary name first
+// and then renamed, so that incremental results are never seen incomplete
+void saveImage(const std::vector<vec3>& image, int width, int height)
+{
+    std::vector<vec3> img = image;
+    saveImageAsPfm("image.pfm.tmp", img, width, height);
+    std::rename("image.pfm.tmp", "image.pfm");
+    uniformRationalQuantization(img, 250.0f, 32.0f);
+    saveImageAsPPM("image.ppm.tmp", to8Bit(img), width, height);
+    std::rename("image.ppm.tmp", "image.ppm");
+}
+
+// Coordinator mode: hand out tiles to workers that connect to the given
+// address, collect the results, and assemble the image incrementally.
+// Tiles of workers that die are handed out again. When no unassigned tiles
+// are left, idle workers get a tile that is still in progress elsewhere, so
+// that a slow worker does not hold up the end of the rendering; the first
+// result wins. The worker sockets are non-blocking and each connection
+// collects its current message as it arrives, so that a slow or stalled
+// worker never blocks the others.
+int coordinator(const std::string& address, int width, int height, int tileSize, int spp)
+{
+    int listenFd = tileSocket(address, true);
+    if (listenFd < 0)
+        return 1;
+    fprintf(stderr, "Waiting for workers on %s\n", address.c_str());
+
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    int tiles = tilesX * tilesY;
+    std::vector<vec3> img(width * height, vec3(0.0f));
+    std::deque<int> unassigned;
+    for (int t = 0; t < tiles; t++)
+        unassigned.push_back(t);
+    std::vector<bool> done(tiles, false);
+    std::vector<int> assignees(tiles, 0);
+    int doneTiles = 0;
+    int savedTiles = 0;
+
+    // per connection: the socket, the assigned tile (-1 if none), and the
+    // part of the current message that was received so far
+    std::vector<pollfd> pollFds(1);
+    pollFds[0].fd = listenFd;
+    pollFds[0].events = POLLIN;
+    std::vector<int> assigned(1, -1);
+    std::vector<std::vector<char>> received(1);
+
+    auto makeAssignment = [&](int t) {
+        TileMessage msg(TileAssignment);
+        msg.tile = t;
+        msg.x = (t % tilesX) * tileSize;
+        msg.y = (t / tilesX) * tileSize;
+        msg.width = std::min(tileSize, width - msg.x);
+        msg.height = std::min(tileSize, height - msg.y);
+        msg.imageWidth = width;
+        msg.imageHeight = height;
+        msg.spp = spp;
+        return msg;
+    };
+
+    // choose the next tile for a worker; -1 if all tiles are done
+    auto nextTile = [&]() {
+        if (!unassigned.empty()) {
+            int t = unassigned.front();
+            unassigned.pop_front();
+            return t;
+        }
+        int best = -1;
+        for (int t = 0; t < tiles; t++)
+            if (!done[t] && (best < 0 || assignees[t] < assignees[best]))
+                best = t;
+        return best;
+    };
+
+    // forget a connection; its tile is handed out again if nobody else has it
+    auto dropConnection = [&](size_t c) {
+        int t = assigned[c];
+        if (t >= 0) {
+            assignees[t]--;
+            if (!done[t] && assignees[t] == 0)
+                unassigned.push_front(t);
+        }
+        close(pollFds[c].fd);
+        pollFds.erase(pollFds.begin() + c);
+        assigned.erase(assigned.begin() + c);
+        received.erase(received.begin() + c);
+    };
+
+    // the size of the message that starts with the received data: a
+    // TileMessage, followed by the pixels of the tile for TileResult
+    auto messageSize = [&](const std::vector<char>& data) {
+        size_t size = sizeof(TileMessage);
+        if (data.size() >= sizeof(TileMessage)) {
+            TileMessage msg;
+            std::memcpy(&msg, data.data(), sizeof(msg));
+            if (msg.type == TileResult)
+                size += size_t(msg.width) * msg.height * sizeof(vec3);
+        }
+        return size;
+    };
+
+    while (doneTiles < tiles) {
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0)
+            continue;
+        if (pollFds[0].revents & POLLIN) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+                close(fd);
+                fd = -1;
+            }
+            if (fd >= 0) {
+                pollfd p;
+                p.fd = fd;
+                p.events = POLLIN;
+                p.revents = 0;
+                pollFds.push_back(p);
+                assigned.push_back(-1);
+                received.push_back(std::vector<char>());
+                fprintf(stderr, "Worker connected (%zu workers)\n", pollFds.size() - 1);
+            }
+        }
+        for (size_t c = pollFds.size() - 1; c > 0; c--) {
+            if (!(pollFds[c].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            int fd = pollFds[c].fd;
+            // read what is available of the current message, but not beyond it
+            std::vector<char>& data = received[c];
+            size_t have = data.size();
+            data.resize(messageSize(data));
+            ssize_t r = read(fd, data.data() + have, data.size() - have);
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                data.resize(have);
+                continue;
+            }
+            if (r <= 0) {
+                if (assigned[c] >= 0)
+                    fprintf(stderr, "Worker with tile %d died, reissuing tile\n", assigned[c]);
+                dropConnection(c);
+                continue;
+            }
+            data.resize(have + r);
+            if (data.size() < sizeof(TileMessage))
+                continue;
+            TileMessage msg;
+            std::memcpy(&msg, data.data(), sizeof(msg));
+            // check the header as soon as it is complete, before its pixels are read
+            if (have < sizeof(TileMessage)) {
+                int t = assigned[c];
+                TileMessage expected = (t >= 0 ? makeAssignment(t) : TileMessage());
+                if (msg.type == TileResult && (t < 0 || msg.tile != t || msg.x != expected.x || msg.y != expected.y
+                            || msg.width != expected.width || msg.height != expected.height
+                            || msg.spp != spp)) {
+                    fprintf(stderr, "Unexpected tile result from worker, dropping it\n");
+                    dropConnection(c);
+                    continue;
+                }
+                if (msg.type != TileResult && (msg.type != TileRequest || t >= 0)) {
+                    fprintf(stderr, "Invalid message from worker\n");
+                    dropConnection(c);
+                    continue;
+                }
+            }
+            if (data.size() < messageSize(data))
+                continue;
+            if (msg.type == TileResult) {
+                int t = assigned[c];
+                std::vector<vec3> tileImg(msg.width * msg.height);
+                std::memcpy(tileImg.data(), data.data() + sizeof(TileMessage), tileImg.size() * sizeof(vec3));
+                if (tileChecksum(tileImg) != msg.checksum) {
+                    fprintf(stderr, "Damaged result for tile %d, reissuing tile\n", t);
+                    dropConnection(c);
+                    continue;
+                }
+                assignees[t]--;
+                assigned[c] = -1;
+                if (!done[t]) {
+                    for (int ty = 0; ty < msg.height; ty++)
+                        for (int tx = 0; tx < msg.width; tx++)
+                            img[(msg.y + ty) * width + (msg.x + tx)] = tileImg[ty * msg.width + tx];
+                    done[t] = true;
+                    doneTiles++;
+                    fprintf(stderr, "Tile %d done (%d of %d)\n", t, doneTiles, tiles);
+                }
+                // save intermediate results every 10% of the tiles
+                if (doneTiles < tiles && (doneTiles - savedTiles) * 10 >= tiles) {
+                    saveImage(img, width, height);
+                    savedTiles = doneTiles;
+                }
+            }
+            data.clear();
+            // hand out the next tile
+            int t = nextTile();
+            if (t < 0)
+                continue;
+            // the worker waits for this small message, so the socket buffer
+            // has room for it even though the socket is non-blocking
+            TileMessage assignment = makeAssignment(t);
+            if (!writeFully(fd, &assignment, sizeof(assignment))) {
+                if (assignees[t] == 0)
+                    unassigned.push_front(t);
+                dropConnection(c);
+                continue;
+            }
+            assigned[c] = t;
+            assignees[t]++;
+        }
+    }
+
+    // tell all workers that we are done
+    for (size_t c = 1; c < pollFds.size(); c++) {
+        TileMessage msg(TileDone);
+        writeFully(pollFds[c].fd, &msg, sizeof(msg));
+        close(pollFds[c].fd);
+    }
+    close(listenFd);
+    if (address.compare(0, 5, "unix:") == 0)
+        unlink(address.substr(5).c_str());
+
+    saveImage(img, width, height);
+    return 0;
+}
 
-int main(void)
+// Merge mode: compute the sample-weighted mean of partial renderings of the
+// complete image, see samplerange.hpp
+int merge(int fileCount, char* fileNames[])
+{
+    std::vector<vec3> img;
+    int width = 0, height = 0;
+    std::vector<std::pair<int, int>> ranges;
+    long long totalSamples = 0;
+    for (int i = 0; i < fileCount; i++) {
+        std::vector<vec3> partial;
+        int w, h, firstSample, sampleCount;
+        if (!loadImageFromPfm(fileNames[i], partial, w, h)) {
+            fprintf(stderr, "%s: cannot load image\n", fileNames[i]);
+            return 1;
+        }
+        if (!loadSampleRange(fileNames[i], firstSample, sampleCount)) {
+            fprintf(stderr, "%s.samples: cannot load sample range\n", fileNames[i]);
+            return 1;
+        }
+        if (i == 0) {
+            width = w;
+            height = h;
+            img.resize(width * height, vec3(0.0f));
+        } else if (w != width || h != height) {
+            fprintf(stderr, "%s: image size differs\n", fileNames[i]);
+            return 1;
+        }
+        for (size_t r = 0; r < ranges.size(); r++) {
+            if (firstSample < ranges[r].first + ranges[r].second && ranges[r].first < firstSample + sampleCount) {
+                fprintf(stderr, "%s: samples %d to %d overlap with a previous file\n",
+                        fileNames[i], firstSample, firstSample + sampleCount - 1);
+                return 1;
+            }
+        }
+        ranges.push_back(std::make_pair(firstSample, sampleCount));
+        for (int j = 0; j < width * height; j++)
+            img[j] += partial[j] * float(sampleCount);
+        totalSamples += sampleCount;
+    }
+    for (int j = 0; j < width * height; j++)
+        img[j] /= float(totalSamples);
+    fprintf(stderr, "Merged %d files with %lld samples per pixel\n", fileCount, totalSamples);
+    saveImage(img, width, height);
+    return 0;
+}
+
+// Usage: tile-composer                      gather tile-<t>.raw files into the image
+//        tile-composer --coordinator <addr> distribute tiles to workers connecting
+//                                           to the given address (unix:path or
+//                                           host:port), see pathtracer-tiles
+//        tile-composer --merge <file.pfm>...  merge partial renderings of disjoint
+//                                           sample ranges, see pathtracer-tiles
+int main(int argc, char* argv[])
 {
     // The image: RGB values per pixel, floating point
     int width = 1024;
     int height = 1024;
     std::vector<vec3> img(width * height);
+    int spp = 8192;
 
     // Tile configuration
     int tileSize = 64;
     int tilesX = width / tileSize;
     int tilesY = height / tileSize;
 
+    if (argc == 3 && std::string(argv[1]) == "--coordinator")
+        return coordinator(argv[2], width, height, tileSize, spp);
+    if (argc >= 3 && std::string(argv[1]) == "--merge")
+        return merge(argc - 2, argv + 2);
+
     // Gather tiles into image
+    int missingTiles = 0;
     for (int t = 0; t < tilesX * tilesY; t++) {
-        std::ifstream ifs("tile-" + std::to_string(t) + ".raw", std::ofstream::binary);
+        std::string fileName = "tile-" + std::to_string(t) + ".raw";
+        std::ifstream ifs(fileName, std::ofstream::binary);
         int myTileY = t / tilesX;
         int myTileX = t % tilesX;
         for (int ty = 0; ty < tileSize; ty++) {
@@ -28,13 +320,17 @@ int main(void)
                     + (y * width + x) * sizeof(vec3),
                     tileSize * sizeof(vec3));
         }
+        if (!ifs || ifs.peek() != EOF) {
+            fprintf(stderr, "%s: missing or wrong size\n", fileName.c_str());
+            missingTiles++;
+        }
         ifs.close();
     }
+    if (missingTiles > 0)
+        fprintf(stderr, "%d of %d tiles are missing or damaged\n", missingTiles, tilesX * tilesY);
 
     // Postprocess and save image
-    saveImageAsPfm("image.pfm", img, width, height);
-    uniformRationalQuantization(img, 250.0f, 32.0f);
-    saveImageAsPPM("image.ppm", to8Bit(img), width, height);
+    saveImage(img, width, height);
 
-    return 0;
+    return missingTiles > 0 ? 1 : 0;
 }
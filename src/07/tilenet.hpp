@@ -0,0 +1,171 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "math.hpp"
+
+// Messages between the tile coordinator (tile-composer) and the tile workers
+// (pathtracer-tiles). A worker sends TileRequest to get its first tile;
+// the coordinator answers with TileAssignment, or TileDone when there is no
+// work left. The worker then renders the tile and sends TileResult followed
+// by the width * height pixels of the tile, which also requests the next
+// tile. Messages are sent in host byte order, so all processes must run on
+// machines with the same endianness.
+typedef enum {
+    TileRequest    = 1,
+    TileAssignment = 2,
+    TileResult     = 3,
+    TileDone       = 4
+} TileMessageType;
+
+class TileMessage
+{
+public:
+    uint32_t type;          // see TileMessageType
+    int32_t tile;           // tile index
+    int32_t x, y;           // position of the tile in the image
+    int32_t width, height;  // size of the tile
+    int32_t imageWidth;     // size of the complete image
+    int32_t imageHeight;
+    int32_t spp;            // samples per pixel
+    uint32_t reserved;
+    uint64_t checksum;      // TileResult: checksum of the pixels
+
+    TileMessage(uint32_t type = TileRequest) :
+        type(type), tile(-1), x(0), y(0), width(0), height(0),
+        imageWidth(0), imageHeight(0), spp(0), reserved(0), checksum(0)
+    {
+    }
+};
+
+// Whether a TileAssignment describes a non-empty tile inside its image, with
+// an image size whose pixel indices fit into int
+inline bool validAssignment(const TileMessage& msg)
+{
+    return msg.tile >= 0 && msg.spp > 0
+        && msg.imageWidth > 0 && msg.imageHeight > 0
+        && int64_t(msg.imageWidth) * msg.imageHeight <= std::numeric_limits<int32_t>::max()
+        && msg.width > 0 && msg.height > 0 && msg.x >= 0 && msg.y >= 0
+        && msg.x <= msg.imageWidth - msg.width && msg.y <= msg.imageHeight - msg.height;
+}
+
+// FNV-1a hash of the pixel data of a tile
+inline uint64_t tileChecksum(const std::vector<vec3>& pixels)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(pixels.data());
+    uint64_t h = 0xcbf29ce484222325u;
+    for (size_t i = 0; i < pixels.size() * sizeof(vec3); i++) {
+        h ^= p[i];
+        h *= 0x100000001b3u;
+    }
+    return h;
+}
+
+// Read or write exactly size bytes on a blocking socket; returns false if the
+// connection is broken
+inline bool readFully(int fd, void* data, size_t size)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t r = read(fd, p, size);
+        if (r <= 0)
+            return false;
+        p += r;
+        size -= r;
+    }
+    return true;
+}
+
+inline bool writeFully(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t r = send(fd, p, size, MSG_NOSIGNAL);
+        if (r <= 0)
+            return false;
+        p += r;
+        size -= r;
+    }
+    return true;
+}
+
+/* Helper to create a socket for an address, which is either "unix:/path/to/socket"
+ * or "host:port" (the host may be empty for listening on all interfaces).
+ * If listening, the socket is bound and listens, otherwise it is connected.
+ * Returns -1 on failure. */
+inline int tileSocket(const std::string& address, bool listening)
+{
+    if (address.compare(0, 5, "unix:") == 0) {
+        std::string path = address.substr(5);
+        sockaddr_un sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(sa.sun_path)) {
+            fprintf(stderr, "%s: socket path too long\n", address.c_str());
+            return -1;
+        }
+        std::strcpy(sa.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (listening)
+            unlink(path.c_str());
+        if ((listening ? bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa))
+                    : connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa))) != 0
+                || (listening && listen(fd, 64) != 0)) {
+            fprintf(stderr, "%s: %s\n", address.c_str(), std::strerror(errno));
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    size_t colon = address.find_last_of(':');
+    if (colon == std::string::npos) {
+        fprintf(stderr, "%s: invalid address, expected unix:path or host:port\n", address.c_str());
+        return -1;
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = (listening ? AI_PASSIVE : 0);
+    addrinfo* result;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0) {
+        fprintf(stderr, "%s: cannot resolve address\n", address.c_str());
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        int one = 1;
+        if (listening)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        else
+            setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+        if (listening ? (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0)
+                : connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0)
+        fprintf(stderr, "%s: cannot %s\n", address.c_str(), listening ? "listen" : "connect");
+    return fd;
+}
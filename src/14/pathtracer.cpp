@@ -146,12 +146,12 @@ public:
 
     vec3 fractalsum(const vec2& tc, float t) const
     {
+        float noise[freqs];
+        noiseTex->octaves(tc, minFreq, freqs, t, noise);
         float amp = 0.6f;
-        float freq = minFreq;
         float value = 0.0f;
         for (int i = 0; i < freqs; i++) {
-            value += amp * 0.5f * (noiseTex->value(tc * freq, t).x() + 1.0f);
-            freq *= 2.0f;
+            value += amp * 0.5f * (noise[i] + 1.0f);
             amp *= 0.5f;
         }
         return vec3(value);
@@ -159,12 +159,12 @@ public:
 
     vec3 turbulence(const vec2& tc, float t) const
     {
+        float noise[freqs];
+        noiseTex->octaves(tc, minFreq, freqs, t, noise);
         float amp = 0.8f;
-        float freq = minFreq;
         float value = 0.0f;
         for (int i = 0; i < freqs; i++) {
-            value += amp * std::abs(noiseTex->value(tc * freq, t).x());
-            freq *= 2.0f;
+            value += amp * std::abs(noise[i]);
             amp *= 0.5f;
         }
         return vec3(value);
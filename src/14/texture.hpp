@@ -6,4 +6,15 @@ class Texture
 {
 public:
     virtual vec3 value(const vec2& /* texcoord */, float /* time */) const = 0;
+
+    // The first component of the values at the frequencies freq, 2 freq,
+    // 4 freq, ..., e.g. the octaves of fractal noise. Noise textures
+    // override this to evaluate all octaves in one call.
+    virtual void octaves(const vec2& texcoord, float freq, int count, float time, float* values) const
+    {
+        for (int i = 0; i < count; i++) {
+            values[i] = value(texcoord * freq, time).x();
+            freq *= 2.0f;
+        }
+    }
 };
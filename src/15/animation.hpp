@@ -1,6 +1,7 @@
 #pragma once
 
 #include "transformation.hpp"
+#include "hasher.hpp"
 
 class Animation
 {
@@ -9,4 +10,7 @@ public:
     {
         return Transformation();
     }
+
+    // Add the parameters of the animation to the hash
+    virtual void hash(Hasher& hasher) const = 0;
 };
@@ -15,4 +15,9 @@ public:
     {
         return T;
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(T);
+    }
 };
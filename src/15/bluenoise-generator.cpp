@@ -0,0 +1,143 @@
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "prng.hpp"
+
+// Generate a toroidal blue noise mask with the void-and-cluster method
+// ("The void-and-cluster method for dither array generation" by Ulichney, 1993)
+// and write it as the header file bluenoise.hpp into the current directory
+// (run this in the source directory). The mask contains the ranks
+// 0..N*N-1; neighboring ranks are spread as evenly as possible.
+
+const int N = 64;
+const float sigma = 1.5f;
+
+// Energy contribution of a point at toroidal distance (dx,dy)
+std::vector<float> energyKernel()
+{
+    std::vector<float> kernel(N * N);
+    for (int dy = 0; dy < N; dy++) {
+        for (int dx = 0; dx < N; dx++) {
+            int x = std::min(dx, N - dx);
+            int y = std::min(dy, N - dy);
+            kernel[dy * N + dx] = std::exp(-(x * x + y * y) / (2.0f * sigma * sigma));
+        }
+    }
+    return kernel;
+}
+
+class Pattern
+{
+public:
+    std::vector<bool> bits;
+    std::vector<float> energy;
+    const std::vector<float>& kernel;
+
+    Pattern(const std::vector<float>& kernel) : bits(N * N, false), energy(N * N, 0.0f), kernel(kernel)
+    {
+    }
+
+    void set(int i, bool value)
+    {
+        bits[i] = value;
+        float sign = (value ? +1.0f : -1.0f);
+        int x = i % N;
+        int y = i / N;
+        for (int ey = 0; ey < N; ey++) {
+            int dy = (ey - y + N) % N;
+            for (int ex = 0; ex < N; ex++) {
+                int dx = (ex - x + N) % N;
+                energy[ey * N + ex] += sign * kernel[dy * N + dx];
+            }
+        }
+    }
+
+    // the set pixel with the highest energy
+    int tightestCluster() const
+    {
+        int best = -1;
+        for (int i = 0; i < N * N; i++)
+            if (bits[i] && (best < 0 || energy[i] > energy[best]))
+                best = i;
+        return best;
+    }
+
+    // the unset pixel with the lowest energy
+    int largestVoid() const
+    {
+        int best = -1;
+        for (int i = 0; i < N * N; i++)
+            if (!bits[i] && (best < 0 || energy[i] < energy[best]))
+                best = i;
+        return best;
+    }
+};
+
+int main(void)
+{
+    std::vector<float> kernel = energyKernel();
+    std::vector<int> ranks(N * N);
+
+    // Initial binary pattern: random points, then swap tightest clusters
+    // into largest voids until the points are evenly distributed
+    Pattern initial(kernel);
+    Prng prng(42);
+    int initialOnes = N * N / 10;
+    for (int n = 0; n < initialOnes; ) {
+        int i = prng.in01() * N * N;
+        if (!initial.bits[i]) {
+            initial.set(i, true);
+            n++;
+        }
+    }
+    for (;;) {
+        int cluster = initial.tightestCluster();
+        initial.set(cluster, false);
+        int largestVoid = initial.largestVoid();
+        if (largestVoid == cluster) {
+            initial.set(cluster, true);
+            break;
+        }
+        initial.set(largestVoid, true);
+    }
+
+    // Phase 1: rank the initial points by removing tightest clusters
+    Pattern removal = initial;
+    for (int rank = initialOnes - 1; rank >= 0; rank--) {
+        int i = removal.tightestCluster();
+        removal.set(i, false);
+        ranks[i] = rank;
+    }
+
+    // Phase 2 and 3: rank the remaining pixels by filling largest voids.
+    // (Since the energy of the zeros is the total energy minus the energy of
+    // the ones, the tightest cluster of zeros is the largest void of ones.)
+    Pattern addition = initial;
+    for (int rank = initialOnes; rank < N * N; rank++) {
+        int i = addition.largestVoid();
+        addition.set(i, true);
+        ranks[i] = rank;
+    }
+
+    // Write the header
+    FILE* f = fopen("bluenoise.hpp", "w");
+    if (!f) {
+        fprintf(stderr, "cannot write bluenoise.hpp\n");
+        return 1;
+    }
+    fprintf(f, "#pragma once\n\n");
+    fprintf(f, "// Toroidal %dx%d blue noise mask, generated by bluenoise-generator.cpp\n\n", N, N);
+    fprintf(f, "const int blueNoiseSize = %d;\n\n", N);
+    fprintf(f, "const unsigned short blueNoiseRanks[blueNoiseSize * blueNoiseSize] = {\n");
+    for (int y = 0; y < N; y++) {
+        for (int x = 0; x < N; x++) {
+            fprintf(f, "%s%d%s", (x % 16 == 0 ? "    " : ""), ranks[y * N + x],
+                    (y * N + x < N * N - 1 ? (x % 16 == 15 ? ",\n" : ", ") : "\n"));
+        }
+    }
+    fprintf(f, "};\n");
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+// Toroidal 64x64 blue noise mask, generated by bluenoise-generator.cpp
+
+const int blueNoiseSize = 64;
+
+const unsigned short blueNoiseRanks[blueNoiseSize * blueNoiseSize] = {
+    3853, 802, 26, 1342, 2318, 1667, 2678, 3436, 2206, 3835, 281, 1708, 3639, 139, 1887, 821,
+    2256, 3219, 1829, 3716, 113, 3204, 2073, 3736, 3471, 486, 1276, 2047, 218, 885, 2608, 457,
+    1268, 3385, 257, 1746, 1191, 2653, 3617, 1885, 247, 3165, 864, 1694, 3933, 150, 3288, 2438,
+    517, 3449, 1789, 651, 2712, 2205, 816, 2961, 1437, 2141, 2605, 3085, 934, 3461, 1231, 1713,
+    389, 2937, 1849, 3558, 891, 3772, 594, 1248, 870, 1857, 3159, 809, 2645, 2298, 3005, 3452,
+    1396, 632, 2955, 1234, 1707, 822, 1420, 358, 1879, 913, 2981, 3814, 1634, 3396, 2150, 3128,
+    765, 2463, 2051, 3059, 3813, 41, 1063, 2976, 605, 3489, 2000, 434, 2628, 1151, 781, 1831,
+    4065, 33, 2953, 3804, 1997, 1216, 4034, 2397, 250, 3573, 1278, 3727, 1654, 565, 2683, 3188,
+    2422, 1190, 3229, 2601, 303, 3019, 1958, 2843, 3610, 423, 2786, 4091, 532, 1547, 1091, 302,
+    4010, 2103, 258, 3528, 2343, 4036, 2697, 3060, 2328, 1507, 2567, 653, 2799, 1055, 51, 3607,
+    1498, 3929, 1012, 629, 2214, 3311, 1478, 4044, 2400, 1272, 3828, 2346, 3062, 1581, 3658, 2876,
+    1308, 2213, 1565, 997, 277, 3239, 521, 1701, 3180, 707, 1951, 129, 2405, 4057, 2052, 867,
+    1510, 3956, 586, 2105, 1070, 1561, 4014, 145, 2475, 1601, 2247, 1229, 2005, 3192, 3688, 2530,
+    1637, 2796, 1031, 2595, 399, 3316, 1142, 32, 3839, 3417, 183, 1835, 3642, 1345, 2395, 1824,
+    2903, 308, 3230, 1590, 2783, 381, 1993, 796, 1644, 2806, 325, 909, 3435, 506, 2044, 280,
+    3393, 727, 3149, 2649, 3619, 1451, 2832, 3684, 1036, 2696, 3383, 1129, 2926, 1371, 224, 3550,
+    2779, 108, 1717, 3751, 3437, 2286, 728, 1356, 3225, 930, 3770, 38, 3527, 890, 408, 1955,
+    712, 3269, 3785, 1472, 1909, 693, 2168, 1723, 764, 1204, 3164, 2238, 422, 3102, 4046, 549,
+    1176, 2597, 1940, 3626, 1250, 3894, 2582, 3111, 137, 3728, 1902, 1436, 2196, 3993, 2727, 926,
+    2412, 3868, 415, 1768, 2243, 853, 2486, 2009, 64, 1528, 2297, 3863, 372, 3286, 1761, 2225,
+    1024, 3291, 2525, 1305, 246, 3101, 2591, 3518, 2016, 502, 3021, 1442, 2635, 2197, 2889, 3842,
+    1321, 57, 2233, 858, 3129, 3895, 2646, 3618, 2896, 2003, 3971, 939, 2686, 1680, 836, 3339,
+    2268, 3833, 800, 96, 2357, 977, 556, 3513, 2136, 1116, 3344, 2983, 59, 1166, 1738, 3282,
+    1468, 1966, 1065, 3492, 194, 3893, 451, 1257, 3991, 3041, 551, 1821, 975, 2609, 3827, 628,
+    3595, 2012, 710, 2866, 954, 1813, 442, 1146, 3931, 1669, 2353, 3418, 296, 1718, 1182, 3160,
+    2418, 1810, 3493, 2838, 227, 1265, 509, 1490, 314, 2518, 534, 1425, 3708, 336, 2551, 1987,
+    199, 1556, 3444, 3052, 1863, 3346, 1674, 1335, 2498, 478, 2664, 745, 3792, 2563, 575, 3747,
+    116, 3029, 2523, 1378, 3215, 1897, 2958, 3367, 2147, 871, 3591, 2815, 2155, 468, 1237, 2948,
+    311, 1400, 4077, 2250, 3263, 3861, 2184, 2925, 119, 2677, 674, 1086, 4006, 619, 3574, 340,
+    956, 4031, 496, 1574, 2039, 3426, 2372, 3057, 1074, 3338, 1777, 3066, 2095, 2880, 1274, 3577,
+    968, 2805, 536, 1360, 2665, 356, 2862, 3669, 865, 3984, 1544, 2270, 1797, 3195, 1398, 2909,
+    2146, 493, 4008, 702, 2736, 1112, 1614, 652, 2589, 1705, 196, 1377, 3778, 3251, 1613, 2414,
+    1840, 3036, 454, 1660, 14, 1506, 689, 3348, 1372, 3662, 2145, 2946, 1847, 2739, 2252, 1527,
+    2666, 3044, 1179, 2555, 3781, 945, 1804, 4062, 2124, 122, 3798, 690, 1102, 9, 3144, 1661,
+    3996, 2399, 2037, 3739, 831, 4086, 2104, 31, 1859, 3174, 264, 3535, 1057, 209, 2389, 790,
+    1201, 3319, 1692, 2253, 21, 3819, 2394, 299, 3479, 1103, 3189, 2364, 742, 1934, 69, 3890,
+    908, 3530, 1132, 2450, 3737, 2788, 1098, 2461, 1895, 902, 3214, 190, 1350, 3361, 834, 3735,
+    134, 2113, 701, 3304, 99, 2791, 722, 365, 3495, 1572, 2726, 2383, 3381, 3858, 2278, 636,
+    283, 3292, 1109, 143, 2319, 1533, 1131, 3063, 2381, 1254, 2738, 646, 2058, 3369, 4061, 1922,
+    3672, 2617, 988, 3552, 1950, 3138, 899, 3696, 2827, 1862, 4063, 394, 2911, 3488, 1110, 2679,
+    650, 2130, 2755, 3378, 555, 2062, 3568, 226, 4042, 520, 1625, 3822, 2471, 363, 1991, 3166,
+    1769, 3847, 1418, 2296, 1686, 3170, 1381, 2524, 2927, 1219, 458, 1931, 1359, 824, 1858, 2675,
+    1456, 2872, 1808, 3508, 3012, 2639, 681, 3494, 469, 3745, 1670, 3905, 2951, 1453, 518, 2774,
+    149, 1525, 368, 2993, 1299, 467, 1563, 2179, 1288, 147, 2109, 971, 2549, 1408, 2226, 3222,
+    1592, 3829, 267, 1353, 1754, 861, 3080, 1455, 2907, 2576, 2089, 1009, 3541, 1232, 2899, 560,
+    1104, 2493, 3525, 403, 3947, 1046, 2177, 3834, 1855, 903, 3233, 3950, 2985, 406, 3649, 3194,
+    932, 3759, 670, 1419, 424, 1933, 3873, 1623, 2128, 905, 2451, 1173, 338, 2529, 969, 1728,
+    3177, 2303, 3970, 752, 2424, 3879, 2752, 3270, 621, 3812, 3034, 1650, 3678, 475, 3979, 187,
+    2528, 1935, 1037, 3206, 2390, 3777, 393, 2215, 1115, 3486, 101, 3105, 708, 2307, 4078, 1476,
+    3403, 225, 921, 2905, 1949, 540, 3314, 40, 635, 3559, 2161, 184, 1612, 2478, 1207, 2045,
+    448, 2228, 2558, 3973, 3147, 987, 245, 2878, 3368, 156, 3116, 1834, 3340, 2090, 3845, 3458,
+    633, 1071, 2852, 2038, 3305, 1764, 94, 1072, 2577, 1473, 2324, 686, 3252, 1880, 928, 2998,
+    3572, 390, 2881, 4033, 83, 2690, 1919, 3321, 573, 1766, 3884, 1394, 2809, 1696, 25, 2135,
+    2659, 1795, 3141, 1281, 2618, 3665, 1566, 2430, 3024, 1392, 2545, 1079, 2837, 3432, 120, 4073,
+    1537, 3366, 53, 1218, 2106, 3447, 2494, 1390, 1054, 2657, 604, 3699, 852, 5, 2934, 1282,
+    1978, 3740, 1604, 313, 1181, 667, 3640, 2030, 3524, 310, 3355, 1171, 20, 2814, 2171, 1206,
+    3238, 1433, 2241, 659, 1647, 957, 1301, 3965, 2440, 883, 2636, 1988, 346, 3674, 3031, 952,
+    3719, 713, 4001, 2265, 268, 866, 2807, 1163, 1996, 4030, 326, 3666, 1964, 631, 2255, 2960,
+    1011, 2751, 1853, 780, 2824, 1676, 620, 3636, 1981, 4055, 2224, 1317, 2578, 1593, 2355, 444,
+    2588, 115, 3388, 2731, 3928, 2476, 2967, 1570, 841, 2734, 1944, 4017, 2415, 1541, 3782, 583,
+    2393, 880, 3681, 1903, 3169, 3586, 2864, 174, 1553, 3236, 438, 3457, 1028, 2411, 585, 3327,
+    1361, 2063, 446, 1532, 3465, 1898, 3878, 223, 3334, 808, 1740, 3135, 922, 1370, 3532, 1756,
+    663, 3818, 2323, 3599, 321, 3923, 2333, 73, 3234, 1559, 379, 3469, 2986, 3952, 744, 3546,
+    3103, 1402, 2266, 923, 1865, 1343, 251, 2261, 3866, 533, 1362, 2944, 776, 3427, 289, 1752,
+    3875, 153, 2768, 1090, 430, 2096, 739, 2272, 3738, 2789, 1243, 2212, 3951, 1486, 1886, 2539,
+    170, 2840, 3283, 2482, 1097, 3064, 649, 1640, 2327, 2879, 512, 2652, 3903, 2454, 342, 2613,
+    3284, 201, 1271, 3220, 1518, 904, 3077, 1261, 747, 2902, 966, 1932, 252, 1177, 2151, 1753,
+    980, 4079, 622, 3013, 431, 3764, 3273, 1138, 3098, 1744, 3657, 221, 2019, 1095, 2648, 3040,
+    2004, 1569, 3420, 2356, 3913, 1513, 3090, 1155, 320, 1945, 662, 3051, 155, 2910, 3529, 1133,
+    3876, 1739, 826, 3757, 93, 2689, 2115, 3496, 1022, 3799, 1508, 2176, 24, 1655, 3704, 1162,
+    2138, 1629, 2965, 527, 2114, 2669, 1791, 3838, 2624, 1732, 3795, 2304, 3285, 537, 3756, 2877,
+    213, 2083, 1526, 3593, 2533, 2036, 695, 2602, 89, 2131, 1043, 2457, 3115, 3937, 1344, 642,
+    1034, 2979, 329, 1327, 2658, 19, 3510, 2484, 1627, 3373, 3843, 1405, 1833, 837, 409, 2289,
+    3117, 503, 2202, 1324, 1690, 4092, 366, 1365, 2556, 195, 3183, 1113, 3402, 805, 3055, 559,
+    3859, 818, 2447, 3982, 1126, 3399, 262, 2180, 495, 3421, 98, 1307, 2724, 1652, 2462, 1332,
+    3472, 2655, 3253, 45, 1015, 1616, 3428, 1427, 4039, 2782, 3509, 685, 1648, 385, 2274, 3497,
+    2550, 3999, 2200, 627, 3336, 1822, 817, 4023, 535, 2627, 946, 2313, 3310, 2715, 4052, 1633,
+    935, 2604, 3560, 2936, 691, 2360, 3243, 783, 3680, 1980, 617, 4019, 1782, 2775, 2032, 1404,
+    2733, 3363, 1809, 35, 2850, 725, 3647, 1431, 1003, 2429, 3074, 703, 4027, 933, 3150, 400,
+    757, 1785, 1153, 2315, 3961, 2913, 318, 2329, 937, 463, 1512, 3226, 2586, 3679, 1776, 54,
+    1383, 842, 1874, 3773, 1026, 2918, 2229, 1323, 2990, 2082, 106, 3648, 505, 1170, 2079, 36,
+    3742, 1217, 210, 1989, 3365, 1114, 1868, 2984, 1618, 2816, 2309, 1339, 2445, 435, 3671, 157,
+    2294, 417, 1295, 3723, 2015, 1646, 2500, 3006, 3935, 1953, 1514, 3526, 2127, 167, 1943, 3659,
+    2242, 3854, 462, 2802, 1873, 823, 3609, 3127, 1798, 3694, 2068, 159, 1259, 927, 2900, 3246,
+    3627, 392, 3113, 2470, 1529, 453, 3730, 204, 1745, 3267, 1253, 2848, 1605, 2515, 3467, 2894,
+    1921, 3232, 1599, 3896, 485, 2711, 48, 3934, 396, 994, 3587, 110, 3109, 1053, 3278, 1587,
+    4087, 1016, 3086, 2559, 489, 3247, 1186, 117, 661, 2823, 375, 1141, 2513, 3289, 1368, 2822,
+    991, 3100, 1464, 3531, 205, 1312, 2119, 611, 2614, 1198, 2846, 3445, 2194, 4080, 668, 2013,
+    1636, 2811, 1258, 172, 3265, 1916, 2693, 3441, 929, 3948, 614, 1883, 3811, 324, 814, 1412,
+    550, 2721, 872, 2499, 1416, 3499, 2234, 1297, 2526, 3342, 1555, 724, 3763, 1892, 2536, 844,
+    2915, 2059, 3474, 1511, 878, 4003, 2189, 3557, 1794, 2325, 3767, 2989, 1719, 606, 3936, 344,
+    1671, 2538, 676, 2193, 3262, 2671, 3877, 1638, 13, 3968, 827, 443, 1619, 2699, 278, 2370,
+    3921, 704, 3570, 2123, 4054, 682, 1139, 2382, 348, 2186, 2573, 3089, 990, 2350, 3028, 3940,
+    2216, 3602, 279, 2085, 3078, 786, 1715, 3633, 595, 1915, 2908, 2133, 2695, 1385, 539, 3544,
+    1748, 657, 181, 2306, 2781, 295, 1576, 950, 3186, 1358, 862, 29, 3567, 1038, 2651, 2144,
+    3605, 70, 3975, 958, 1689, 428, 1107, 3424, 2308, 3070, 1846, 2407, 3797, 1326, 3377, 1042,
+    90, 2676, 1743, 959, 2593, 1449, 3628, 3162, 1666, 1351, 3682, 76, 1499, 3332, 1812, 130,
+    1030, 1665, 3315, 1157, 4037, 220, 2914, 1020, 3191, 173, 4048, 936, 305, 3898, 2254, 78,
+    2714, 3915, 1263, 3702, 1904, 3384, 2954, 2483, 207, 4066, 2707, 1946, 2280, 3155, 1458, 749,
+    3335, 1275, 1899, 3053, 3654, 2376, 2975, 743, 1462, 306, 3317, 998, 2883, 592, 1818, 3079,
+    1482, 2201, 3210, 473, 3010, 46, 2029, 547, 2845, 3392, 791, 2011, 4043, 593, 1273, 2797,
+    3715, 2432, 2932, 564, 1817, 2404, 3788, 2159, 1515, 2449, 1266, 3475, 1706, 3045, 1161, 3218,
+    1485, 2434, 3002, 992, 477, 1352, 669, 3622, 2033, 591, 3297, 1548, 480, 3796, 233, 1803,
+    2966, 2332, 2762, 515, 1397, 107, 1999, 3697, 2759, 2142, 1284, 3583, 154, 2107, 3744, 2522,
+    868, 3468, 1214, 3871, 1610, 2352, 3791, 943, 2510, 248, 1193, 2939, 2626, 2292, 3483, 2053,
+    750, 343, 1410, 3566, 2769, 1314, 733, 384, 2829, 3712, 616, 2291, 2778, 716, 2002, 3695,
+    855, 292, 2091, 3302, 2592, 3891, 2227, 1144, 1642, 2542, 967, 3604, 1240, 2772, 2443, 4040,
+    1101, 186, 869, 3359, 2547, 4067, 1611, 983, 452, 3909, 640, 2554, 1539, 3221, 1185, 407,
+    3995, 1929, 188, 2713, 784, 3242, 1291, 1872, 3927, 2163, 3589, 1659, 421, 1075, 200, 3114,
+    1621, 3981, 1983, 910, 1, 3205, 2007, 3414, 1118, 1825, 3275, 37, 1407, 3429, 370, 2621,
+    1816, 3561, 699, 1595, 7, 1767, 2748, 282, 3840, 2920, 360, 2167, 3068, 806, 1994, 590,
+    3540, 1615, 3869, 1952, 1192, 609, 3096, 2492, 3349, 1679, 3049, 1956, 3963, 770, 2275, 2997,
+    2765, 626, 2439, 3632, 2065, 240, 3498, 412, 3033, 1440, 694, 3140, 3886, 1893, 3741, 2453,
+    1143, 2716, 3303, 2269, 3841, 2575, 1641, 3918, 229, 2643, 919, 1982, 3766, 2436, 1069, 3980,
+    1329, 2284, 3054, 4059, 1032, 3484, 3104, 840, 3405, 1289, 1790, 3985, 75, 1682, 3416, 1364,
+    2603, 3058, 2263, 331, 2857, 3451, 2100, 231, 1152, 2264, 85, 940, 2821, 337, 3569, 1573,
+    1052, 3389, 1393, 1751, 1080, 2803, 2481, 1716, 875, 2681, 4, 2258, 860, 2776, 1467, 666,
+    3579, 140, 602, 1584, 1212, 459, 877, 2964, 2345, 1531, 4015, 2849, 571, 1714, 3073, 97,
+    2860, 499, 1174, 2459, 2048, 545, 1421, 1986, 2312, 680, 3257, 2396, 1125, 3752, 2875, 260,
+    2060, 488, 1005, 3612, 1773, 843, 1452, 3645, 2784, 3803, 1409, 3500, 2435, 1290, 1894, 62,
+    2156, 3032, 287, 4074, 3146, 700, 3709, 1184, 3337, 4028, 1925, 3478, 1300, 3287, 271, 2158,
+    2992, 1848, 2596, 3112, 3491, 2126, 3641, 1331, 687, 3157, 404, 2192, 1296, 3295, 760, 2067,
+    3506, 1685, 3734, 228, 2884, 3826, 2568, 133, 3652, 2808, 269, 1502, 2633, 557, 2257, 1211,
+    3272, 3790, 1471, 2674, 141, 3945, 2403, 500, 1878, 735, 3132, 1775, 524, 3259, 3784, 2565,
+    1687, 3594, 893, 2281, 455, 1463, 2120, 171, 2337, 581, 1564, 2836, 374, 2490, 1651, 4056,
+    820, 1318, 3901, 1025, 263, 2885, 1711, 80, 3379, 1783, 1064, 3564, 164, 3889, 2358, 1492,
+    2562, 901, 3167, 1861, 754, 1209, 3249, 1620, 1078, 1864, 3844, 925, 3521, 3139, 882, 3994,
+    1709, 721, 2384, 3182, 2074, 1228, 2924, 3300, 1058, 2564, 270, 4093, 2208, 993, 2882, 688,
+    441, 1270, 2746, 1908, 3487, 2963, 3888, 1793, 3161, 2612, 1099, 3643, 755, 3793, 1029, 2750,
+    3397, 362, 2385, 1998, 734, 2452, 4084, 2700, 2219, 3852, 2516, 2995, 1930, 2668, 1105, 266,
+    3939, 410, 2684, 1406, 3585, 2367, 426, 3990, 2641, 548, 2972, 2137, 1699, 193, 1961, 2663,
+    18, 2970, 1148, 414, 3439, 675, 1720, 63, 3908, 2022, 1213, 2767, 1617, 142, 1439, 3966,
+    3137, 2427, 3848, 28, 1178, 2442, 955, 345, 1389, 3825, 128, 2041, 3151, 1788, 2316, 56,
+    1923, 3046, 1558, 3753, 3308, 1417, 1094, 510, 897, 1395, 332, 794, 1516, 538, 3473, 2871,
+    1972, 1233, 3328, 2172, 55, 3092, 1900, 851, 2235, 3462, 1262, 361, 2508, 3725, 1255, 3408,
+    2232, 3638, 1881, 4032, 1534, 2720, 3673, 2245, 1434, 2945, 3440, 572, 3691, 2507, 3400, 2055,
+    203, 1792, 769, 3254, 1657, 567, 2687, 3584, 2211, 896, 2935, 2441, 1235, 531, 3325, 1428,
+    3687, 984, 528, 2732, 104, 1850, 3093, 3590, 1967, 3209, 3512, 2166, 3824, 3082, 1757, 798,
+    3692, 2425, 634, 4026, 947, 1488, 3761, 2868, 103, 1562, 3203, 4094, 761, 2793, 513, 1517,
+    973, 328, 2580, 767, 2203, 286, 1013, 3168, 787, 395, 2282, 941, 1920, 3018, 782, 1150,
+    2818, 3549, 1403, 2218, 2929, 3987, 1939, 3271, 456, 1729, 3425, 1493, 237, 3916, 2590, 679,
+    2110, 2497, 3551, 1244, 2143, 3920, 341, 2379, 2825, 158, 1693, 2753, 1195, 43, 2293, 1315,
+    3126, 165, 1668, 2922, 2018, 2616, 584, 1175, 3624, 2021, 982, 2277, 1630, 3131, 2088, 3955,
+    2891, 1681, 3333, 1196, 3123, 3780, 1959, 2615, 3581, 1784, 3882, 3250, 1309, 327, 2320, 3746,
+    664, 2521, 354, 3375, 916, 152, 1500, 1168, 3007, 4088, 684, 2704, 3537, 1877, 3009, 1169,
+    4020, 239, 1703, 3208, 607, 2906, 1585, 732, 1238, 4011, 1007, 589, 2472, 3331, 4070, 481,
+    1907, 3565, 1120, 3731, 275, 3413, 1741, 2431, 3048, 530, 2761, 256, 3677, 1062, 144, 3279,
+    720, 2334, 3883, 100, 2854, 1603, 570, 1328, 197, 2448, 1481, 17, 2640, 4025, 1759, 1445,
+    2081, 3914, 1239, 1970, 2631, 3563, 2305, 759, 2512, 81, 2094, 1085, 2259, 849, 1600, 387,
+    3156, 2702, 829, 2314, 3802, 996, 2598, 3700, 1823, 2267, 3030, 3675, 1842, 839, 1543, 2819,
+    2557, 696, 2188, 2701, 1325, 863, 3924, 189, 1429, 3855, 1807, 3410, 1354, 2469, 1852, 2620,
+    1336, 449, 2035, 1450, 876, 2402, 3212, 4060, 2804, 1092, 3107, 2075, 838, 3442, 511, 3172,
+    72, 2904, 746, 3706, 1607, 525, 2867, 3774, 1780, 1298, 3324, 3837, 464, 2792, 3789, 2359,
+    1896, 1422, 3490, 151, 1912, 1380, 3374, 16, 3163, 492, 1479, 217, 2851, 2118, 288, 3718,
+    1017, 3380, 1578, 416, 3241, 2338, 2931, 2077, 3345, 907, 2570, 731, 3027, 494, 3860, 889,
+    3620, 2988, 3431, 2682, 3810, 1837, 376, 2132, 751, 3503, 497, 3794, 1609, 2870, 2446, 1093,
+    3356, 1697, 2344, 206, 3125, 1044, 2017, 367, 3202, 2760, 304, 1631, 3097, 1382, 2, 3312,
+    705, 3755, 1076, 2795, 3091, 411, 2365, 2001, 911, 3865, 2629, 3501, 1122, 3892, 3094, 1333,
+    2335, 71, 3039, 4012, 1815, 574, 1568, 373, 1135, 2285, 77, 3779, 2117, 1635, 3350, 2178,
+    39, 1750, 1073, 654, 230, 3362, 1223, 3644, 1520, 1911, 2661, 2295, 1220, 364, 1947, 3686,
+    2594, 964, 4045, 1330, 2466, 3386, 3958, 1444, 898, 3596, 1985, 2413, 813, 3580, 2121, 1136,
+    2584, 351, 2173, 1658, 4000, 856, 3664, 1597, 2898, 1267, 2056, 736, 1675, 2464, 554, 1778,
+    3514, 2008, 873, 2467, 1149, 3765, 3443, 2692, 4049, 3248, 1672, 1256, 2691, 215, 1137, 2842,
+    1503, 3967, 2537, 1938, 3022, 942, 2553, 2921, 87, 3223, 961, 232, 3004, 3978, 763, 1501,
+    3095, 501, 1905, 2959, 698, 1737, 30, 2625, 2276, 624, 1167, 3917, 2654, 544, 1721, 4068,
+    3001, 1487, 3280, 643, 2502, 1302, 2740, 618, 3438, 294, 2401, 3213, 61, 3382, 948, 2717,
+    388, 3849, 1477, 2897, 132, 2190, 779, 1355, 1928, 542, 2893, 3542, 846, 4018, 3153, 671,
+    2410, 436, 3545, 1311, 2249, 4004, 1643, 588, 2351, 3954, 1367, 3611, 1724, 3309, 2153, 244,
+    1277, 2273, 3415, 274, 3683, 2183, 1246, 3016, 3714, 1867, 2949, 180, 1524, 3401, 2812, 202,
+    887, 2378, 3856, 68, 2028, 3323, 255, 2139, 4071, 1008, 1781, 3801, 1426, 2175, 4024, 3043,
+    1194, 2569, 648, 3667, 1968, 3171, 2561, 198, 3071, 979, 2417, 350, 1876, 2246, 1387, 3660,
+    1969, 949, 2737, 339, 3227, 148, 2061, 3713, 848, 1845, 2758, 644, 2468, 1035, 2770, 3874,
+    3554, 819, 2638, 1465, 2780, 833, 3330, 483, 1560, 357, 3485, 2152, 915, 2317, 1280, 2020,
+    3482, 1787, 1208, 2719, 1000, 3786, 1800, 3099, 1441, 2511, 2994, 378, 2817, 692, 1924, 146,
+    1639, 2148, 3354, 316, 1386, 989, 3502, 1700, 3743, 2092, 3930, 1438, 3087, 491, 2587, 243,
+    3341, 3017, 1594, 3851, 859, 1470, 3455, 1189, 3065, 347, 3371, 2072, 118, 1457, 529, 1836,
+    44, 1673, 3821, 461, 1977, 4021, 2423, 1056, 3850, 2706, 1252, 3199, 3983, 419, 3056, 3809,
+    673, 333, 3178, 3597, 1591, 382, 2583, 847, 168, 3398, 730, 1294, 3656, 2579, 1066, 3216,
+    3722, 828, 2744, 1841, 2969, 3910, 352, 2302, 711, 1287, 23, 2729, 3480, 1084, 3760, 1742,
+    1199, 2287, 639, 1882, 2480, 2844, 514, 2195, 2644, 1583, 1121, 3899, 2919, 3705, 3231, 2527,
+    3003, 2170, 1040, 3185, 1264, 125, 1727, 3136, 2071, 810, 1664, 50, 1805, 2543, 1083, 1624,
+    2458, 2890, 2099, 741, 2340, 2952, 1260, 3922, 2210, 1826, 3830, 2301, 1653, 465, 3543, 1348,
+    2460, 476, 3992, 1127, 2240, 598, 1522, 2847, 3407, 2496, 3264, 1683, 678, 2185, 2933, 762,
+    4051, 52, 3553, 3152, 1123, 3733, 1755, 3200, 0, 3592, 2506, 726, 1712, 2181, 799, 1183,
+    4081, 625, 3533, 2354, 2858, 3470, 630, 2606, 234, 3601, 2408, 2892, 3450, 718, 3637, 114,
+    3294, 974, 1461, 4041, 508, 3463, 1691, 3179, 546, 2835, 953, 82, 3296, 2087, 2853, 219,
+    2010, 3121, 1567, 34, 3268, 2610, 3615, 1059, 1820, 482, 924, 2064, 3885, 161, 1557, 2501,
+    1954, 2839, 1430, 439, 2093, 273, 807, 4075, 1014, 1974, 413, 3124, 1283, 398, 3453, 1901,
+    2718, 1542, 169, 1762, 884, 2122, 1504, 3897, 1292, 3025, 613, 1156, 2043, 1432, 2773, 2154,
+    3907, 1843, 222, 2656, 1145, 1965, 22, 1002, 3651, 1505, 2534, 3015, 1158, 4053, 774, 1734,
+    3775, 986, 2369, 3556, 1774, 832, 2076, 177, 3925, 2942, 3663, 2660, 1249, 3142, 3562, 355,
+    3276, 1047, 2419, 3943, 2647, 3430, 1313, 2386, 2833, 1469, 3726, 2239, 3986, 2826, 2380, 309,
+    1303, 3245, 2540, 3926, 445, 3621, 3173, 970, 1870, 2187, 4082, 301, 3717, 3187, 432, 1221,
+    603, 2999, 3588, 2134, 3119, 3776, 2764, 2406, 2046, 290, 3880, 1890, 563, 2474, 1475, 3394,
+    2685, 641, 2957, 1340, 437, 4089, 3075, 1446, 2244, 1172, 317, 1579, 562, 2279, 857, 1349,
+    3857, 516, 1844, 888, 1546, 2928, 1806, 175, 3507, 599, 2622, 900, 111, 1575, 962, 3729,
+    709, 2209, 999, 3069, 1374, 2420, 12, 2771, 433, 3357, 1602, 2672, 886, 1733, 2473, 3520,
+    1632, 2342, 1319, 850, 323, 1474, 719, 3372, 1205, 3084, 756, 1375, 3603, 3122, 272, 2300,
+    1230, 135, 3832, 1942, 2730, 1159, 2426, 677, 3504, 2574, 1869, 3306, 4029, 2723, 1786, 2940,
+    2101, 2623, 3685, 102, 3266, 582, 3769, 2111, 3072, 1160, 1832, 3190, 2054, 3613, 3020, 1819,
+    3370, 3808, 259, 1971, 2830, 815, 1678, 3771, 2348, 740, 1227, 3106, 2299, 191, 3953, 773,
+    2741, 65, 3228, 3690, 2531, 1827, 4022, 418, 1684, 3516, 2248, 2708, 402, 2049, 1033, 3911,
+    1854, 3293, 2220, 803, 3412, 254, 3762, 1736, 49, 2987, 793, 2125, 131, 1039, 3750, 211,
+    738, 1586, 3026, 2236, 1202, 2477, 976, 391, 1519, 3962, 307, 3466, 1357, 552, 2488, 179,
+    1180, 2735, 1726, 3576, 519, 4038, 2070, 1096, 2991, 3635, 109, 1984, 3805, 1087, 2977, 2098,
+    3404, 1041, 1957, 569, 2874, 1019, 2222, 2978, 2566, 126, 1088, 3977, 1645, 2856, 3511, 576,
+    3008, 1435, 383, 2544, 1606, 2873, 2050, 3277, 1049, 3870, 1369, 3598, 3081, 1509, 2409, 3154,
+    3539, 1061, 420, 3460, 1889, 3989, 2798, 3409, 2260, 2728, 797, 2388, 2801, 1023, 3904, 2086,
+    466, 1460, 766, 3207, 1200, 2491, 3391, 261, 1443, 1811, 2485, 3476, 601, 1521, 1860, 335,
+    1391, 4095, 2456, 1589, 3836, 105, 3261, 1366, 906, 3707, 1963, 665, 3313, 6, 1496, 2437,
+    874, 2745, 4002, 1089, 3689, 714, 1337, 460, 2680, 2217, 405, 2509, 706, 1976, 498, 1245,
+    2207, 4083, 2831, 1415, 748, 162, 1662, 1224, 610, 1960, 3815, 1688, 27, 3523, 1545, 2971,
+    3298, 3976, 2535, 2149, 112, 1552, 3061, 658, 2667, 3997, 931, 1373, 2757, 3235, 3724, 2585,
+    683, 2956, 253, 3322, 1226, 1927, 3629, 580, 1779, 2688, 3197, 2347, 1236, 2619, 1914, 3655,
+    182, 3387, 1731, 2157, 84, 3014, 2363, 3946, 1598, 3133, 1838, 1187, 2841, 3964, 3419, 2694,
+    1704, 15, 1990, 2517, 3623, 3145, 2377, 3698, 3038, 238, 3307, 1247, 3067, 1973, 729, 2321,
+    1018, 1875, 349, 3754, 2888, 1913, 995, 3555, 2102, 319, 2930, 484, 2262, 47, 917, 2164,
+    3600, 1725, 2290, 785, 2725, 429, 2519, 2162, 3960, 276, 1466, 425, 3481, 758, 4076, 1067,
+    2097, 1320, 522, 2637, 3464, 1891, 1004, 3534, 768, 242, 3721, 3290, 88, 1649, 892, 315,
+    3196, 938, 3358, 490, 1154, 2040, 380, 854, 2541, 1454, 914, 2311, 471, 3957, 2632, 166,
+    3625, 3110, 1334, 835, 3456, 504, 3932, 2373, 1222, 3258, 1622, 3433, 1828, 3941, 1285, 3130,
+    397, 1082, 3902, 1447, 3578, 3143, 1551, 825, 3023, 1111, 2834, 3846, 1747, 3037, 297, 2374,
+    3244, 2886, 3787, 894, 1423, 3198, 298, 2599, 2078, 1401, 2742, 960, 2182, 3768, 2571, 2031,
+    3887, 1347, 2756, 1749, 3867, 2865, 1550, 3942, 1871, 3505, 2787, 3703, 1771, 1165, 3376, 1489,
+    637, 2433, 2785, 1760, 2288, 1459, 2705, 58, 1772, 723, 3758, 1100, 2479, 697, 2777, 1535,
+    3411, 1948, 2642, 8, 2023, 1027, 3816, 136, 3519, 2326, 1937, 881, 2221, 1338, 2709, 1596,
+    608, 1866, 208, 2330, 3974, 623, 1763, 1164, 3320, 4090, 638, 2455, 1495, 470, 1128, 2968,
+    647, 2362, 3536, 771, 124, 2341, 1050, 3255, 79, 672, 2069, 192, 2487, 804, 2912, 2140,
+    4072, 42, 1124, 3817, 285, 3301, 811, 3720, 3011, 2572, 2057, 163, 3083, 3616, 2080, 185,
+    2392, 578, 3517, 2950, 655, 2387, 2813, 1802, 1322, 615, 3318, 66, 3646, 523, 3343, 3862,
+    981, 3631, 1279, 2996, 1979, 2698, 3701, 2947, 2331, 121, 1926, 3614, 2917, 3395, 1851, 3668,
+    1538, 330, 2066, 1197, 3193, 3630, 543, 2231, 2941, 1293, 4007, 1571, 3211, 3653, 300, 1722,
+    3050, 2006, 3423, 656, 2943, 1941, 1134, 2199, 1376, 427, 4064, 1483, 568, 1702, 1048, 4013,
+    3042, 965, 1346, 1695, 4050, 1242, 334, 3184, 2630, 4016, 1540, 2973, 2503, 1147, 2027, 123,
+    2560, 2129, 3351, 472, 1108, 3, 1536, 879, 526, 1677, 3148, 1241, 235, 830, 2310, 67,
+    3181, 2600, 3969, 2923, 1856, 2634, 1399, 1735, 3448, 2428, 978, 2859, 587, 1310, 2339, 1010,
+    447, 1306, 2611, 1549, 2398, 3998, 474, 3217, 3548, 963, 2754, 2361, 3459, 2916, 322, 2581,
+    1799, 3800, 2251, 371, 3329, 2112, 3634, 944, 2014, 265, 2366, 972, 1710, 3972, 2861, 1388,
+    3120, 717, 1626, 2391, 3571, 3108, 2160, 3912, 3454, 2763, 918, 3864, 2025, 2673, 4035, 1251,
+    1765, 985, 553, 1484, 212, 895, 4085, 369, 795, 3783, 293, 2169, 1801, 3881, 2722, 3522,
+    2204, 3900, 845, 3175, 127, 1286, 2828, 1698, 236, 1917, 3134, 778, 1210, 2223, 3676, 1424,
+    772, 91, 2743, 3088, 792, 2548, 1554, 558, 3347, 1215, 3748, 579, 3201, 241, 812, 1814,
+    3807, 353, 2710, 4058, 789, 1316, 2546, 284, 1995, 1363, 2421, 386, 3281, 1523, 507, 3364,
+    2810, 3608, 2283, 3274, 3693, 2084, 2895, 3326, 1962, 2650, 1497, 3035, 3360, 86, 777, 1577,
+    2901, 249, 3575, 1796, 2191, 3650, 737, 2607, 2322, 3732, 1582, 11, 3949, 1839, 440, 3158,
+    3434, 2024, 3661, 1140, 1906, 216, 2962, 3806, 2271, 2869, 1918, 3477, 2662, 2165, 3538, 2444,
+    1130, 3446, 1411, 1992, 178, 1830, 3224, 1045, 2938, 645, 3582, 1758, 2980, 1060, 2495, 2116,
+    753, 160, 1910, 1119, 2514, 596, 1304, 2349, 10, 1188, 3606, 541, 1068, 2552, 1936, 3237,
+    1081, 1480, 2489, 561, 1051, 3299, 1494, 3944, 1077, 566, 3406, 2108, 2800, 660, 2465, 1117,
+    1628, 2505, 479, 1491, 3390, 3959, 1269, 1770, 74, 801, 1580, 359, 1106, 1448, 600, 2982,
+    92, 2198, 920, 3260, 2887, 3872, 450, 3515, 1608, 4005, 60, 2174, 715, 3670, 312, 3820,
+    1588, 3118, 3938, 401, 3000, 1656, 3823, 1001, 2790, 3240, 1730, 2375, 3988, 1414, 3710, 597,
+    3422, 2042, 2794, 4047, 3047, 377, 2034, 95, 2974, 1413, 2532, 1006, 3256, 1341, 3831, 2855,
+    214, 3919, 912, 2670, 2237, 612, 2766, 1021, 2504, 3176, 4069, 2416, 3076, 3711, 1884, 4009,
+    1663, 2749, 3749, 577, 2368, 1530, 775, 2230, 2703, 1203, 2520, 3352, 1384, 2820, 1975, 1225,
+    2747, 951, 2371, 1379, 3547, 138, 3353, 1888, 487, 3906, 788, 291, 2026, 2863, 176, 2336
+};
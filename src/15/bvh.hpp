@@ -211,4 +211,9 @@ public:
 
         return hr;
     }
+
+    virtual void hash(Hasher& /* hasher */) const override
+    {
+        // the tree only depends on its surfaces, which are hashed themselves
+    }
 };
@@ -5,7 +5,7 @@
 #include "math.hpp"
 #include "animation.hpp"
 #include "sampler.hpp"
-#include "prng.hpp"
+#include "hasher.hpp"
 
 // Pinhole camera class
 class Camera
@@ -31,26 +31,53 @@ public:
     {
     }
 
-    Ray getRay(float p, float q, float t0, float t1, Prng& prng)
+    void hash(Hasher& hasher) const
+    {
+        hasher.add(t);
+        hasher.add(b);
+        hasher.add(r);
+        hasher.add(l);
+        hasher.add(focusDistance);
+        hasher.add(apertureRadius);
+        hasher.addObject(animation);
+    }
+
+    // Get the ray through the point (p,q) of the image, both in [0,1].
+    // If the pixel size (dp,dq) is given, the ray gets differentials for the
+    // neighboring pixels; they use the same point on the lens and time.
+    Ray getRay(float p, float q, float t0, float t1, Sampler& sampler, float dp = 0.0f, float dq = 0.0f) const
     {
         // get origin O and point P on image plane
         vec3 P = vec3(mix(l, r, p), mix(b, t, q), -1.0f);
         vec3 O = vec3(0.0f);
         // apply depth of field effect
         P *= focusDistance;
-        vec2 pointOnLens = apertureRadius * Sampler::uniformInDisk(prng.in01(), prng.in01());
+        vec2 lensSample = sampler.in01x2();
+        vec2 pointOnLens = apertureRadius * Sampler::uniformInDisk(lensSample.x(), lensSample.y());
         O = vec3(pointOnLens.x(), pointOnLens.y(), 0.0f);
-        // compute direction D
+        // compute direction D, and the directions Dx and Dy of the differentials
         vec3 D = P - O;
+        vec3 Dx = D + vec3(dp * (r - l) * focusDistance, 0.0f, 0.0f);
+        vec3 Dy = D + vec3(0.0f, dq * (t - b) * focusDistance, 0.0f);
         // assign time
-        float t = mix(t0, t1, prng.in01());
+        float t = mix(t0, t1, sampler.in01());
         // transform
         if (animation) {
             Transformation T = animation->at(t);
             O = T * O;
             D = T.rotation * D;
+            Dx = T.rotation * Dx;
+            Dy = T.rotation * Dy;
         }
         // create ray
-        return Ray(O, normalize(D), t);
+        Ray ray(O, normalize(D), t);
+        if (dp > 0.0f && dq > 0.0f) {
+            ray.hasDifferentials = true;
+            ray.dxOrigin = O;
+            ray.dxDirection = normalize(Dx);
+            ray.dyOrigin = O;
+            ray.dyDirection = normalize(Dy);
+        }
+        return ray;
     }
 };
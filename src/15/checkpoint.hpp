@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include "framebuffer.hpp"
+#include "hasher.hpp"
+
+// A checkpoint of a progressive rendering: the framebuffer together with
+// the state of the pass loop, so that rendering can continue later exactly
+// where it stopped. Checkpoints are only valid for the scene and render
+// parameters they were created with; their hashes are stored with them.
+class Checkpoint
+{
+public:
+    uint64_t sceneHash;
+    uint64_t parameterHash;
+    int pass;           // the next pass to render
+    uint64_t budget;    // remaining sample budget
+    double elapsed;     // rendering time so far, in seconds
+
+    static constexpr char magic[8] = { 'P', 'T', 'C', 'H', 'E', 'C', 'K', '1' };
+
+    // Save the checkpoint and the framebuffer. The file is written with a
+    // temporary name first and then renamed, so that a crash while writing
+    // never destroys the previous checkpoint.
+    bool save(const std::string& fileName, const Framebuffer& fb) const
+    {
+        std::string tmpName = fileName + ".tmp";
+        FILE* f = fopen(tmpName.c_str(), "wb");
+        if (!f)
+            return false;
+        size_t n = size_t(fb.width) * fb.height;
+        int32_t size[2] = { fb.width, fb.height };
+        bool ok = fwrite(magic, sizeof(magic), 1, f) == 1
+            && fwrite(size, sizeof(size), 1, f) == 1
+            && fwrite(&sceneHash, sizeof(sceneHash), 1, f) == 1
+            && fwrite(&parameterHash, sizeof(parameterHash), 1, f) == 1
+            && fwrite(&pass, sizeof(pass), 1, f) == 1
+            && fwrite(&budget, sizeof(budget), 1, f) == 1
+            && fwrite(&elapsed, sizeof(elapsed), 1, f) == 1
+            && fwrite(fb.sum.data(), sizeof(vec3), n, f) == n
+            && fwrite(fb.mean.data(), sizeof(float), n, f) == n
+            && fwrite(fb.m2.data(), sizeof(float), n, f) == n
+            && fwrite(fb.samples.data(), sizeof(unsigned int), n, f) == n;
+        ok = (fclose(f) == 0) && ok;
+        if (ok)
+            ok = (std::rename(tmpName.c_str(), fileName.c_str()) == 0);
+        if (!ok)
+            std::remove(tmpName.c_str());
+        return ok;
+    }
+
+    // Load a checkpoint into the framebuffer. This fails if the file does not
+    // exist, is damaged, or does not match the framebuffer size and the
+    // given hashes; the checkpoint and framebuffer are unchanged in that case.
+    bool load(const std::string& fileName, Framebuffer& fb)
+    {
+        FILE* f = fopen(fileName.c_str(), "rb");
+        if (!f)
+            return false;
+        size_t n = size_t(fb.width) * fb.height;
+        char fileMagic[8];
+        int32_t size[2];
+        Checkpoint c;
+        bool ok = fread(fileMagic, sizeof(fileMagic), 1, f) == 1
+            && std::memcmp(fileMagic, magic, sizeof(magic)) == 0
+            && fread(size, sizeof(size), 1, f) == 1
+            && size[0] == fb.width && size[1] == fb.height
+            && fread(&c.sceneHash, sizeof(c.sceneHash), 1, f) == 1
+            && fread(&c.parameterHash, sizeof(c.parameterHash), 1, f) == 1
+            && c.sceneHash == sceneHash && c.parameterHash == parameterHash
+            && fread(&c.pass, sizeof(c.pass), 1, f) == 1
+            && fread(&c.budget, sizeof(c.budget), 1, f) == 1
+            && fread(&c.elapsed, sizeof(c.elapsed), 1, f) == 1;
+        Framebuffer tmp(fb.width, fb.height);
+        ok = ok
+            && fread(tmp.sum.data(), sizeof(vec3), n, f) == n
+            && fread(tmp.mean.data(), sizeof(float), n, f) == n
+            && fread(tmp.m2.data(), sizeof(float), n, f) == n
+            && fread(tmp.samples.data(), sizeof(unsigned int), n, f) == n
+            && fgetc(f) == EOF;
+        fclose(f);
+        if (ok) {
+            *this = c;
+            fb = std::move(tmp);
+        }
+        return ok;
+    }
+};
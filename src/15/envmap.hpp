@@ -1,6 +1,7 @@
 #pragma once
 
 #include "math.hpp"
+#include "hasher.hpp"
 
 class EnvMap
 {
@@ -9,4 +10,23 @@ public:
     {
         return vec3(0.0f);
     }
+
+    // The value filtered over a footprint of the given angle in radians,
+    // e.g. the angle between the rays through neighboring pixels. Maps that
+    // cannot filter return the unfiltered value.
+    virtual vec3 filteredValue(const vec3& direction, float /* footprint */, float t) const
+    {
+        return value(direction, t);
+    }
+
+    // The face size of an EnvMapPrepared that keeps the resolution of the
+    // map, or 0 if the map has no texels (e.g. a constant map) so that
+    // preparing it gains nothing
+    virtual int preparedFaceSize() const
+    {
+        return 0;
+    }
+
+    // Add the data of the map to the hash
+    virtual void hash(Hasher& hasher) const = 0;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "envmap.hpp"
 #include "texture.hpp"
 
@@ -38,4 +40,18 @@ public:
         }
         return cubesides[cubeside]->value(vec2(u, v), t);
     }
+
+    virtual int preparedFaceSize() const override
+    {
+        int s = 0;
+        for (int i = 0; i < 6; i++)
+            s = std::max(s, cubesides[i]->texelWidth());
+        return s;
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        for (int i = 0; i < 6; i++)
+            hasher.addObject(cubesides[i]);
+    }
 };
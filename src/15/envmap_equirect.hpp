@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "envmap.hpp"
 #include "texture.hpp"
 
@@ -20,4 +22,16 @@ public:
         float v = theta / pi + 0.5f;
         return map->value(vec2(u, v), t);
     }
+
+    // the image spans 2 pi horizontally, a cube face pi / 2
+    virtual int preparedFaceSize() const override
+    {
+        int w = map->texelWidth();
+        return w > 0 ? std::max(w / 4, 1) : 0;
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(map);
+    }
 };
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "envmap.hpp"
+#include "texture_filter.hpp"
+
+// An environment map prepared at load time for fast lookups: any other
+// environment map (e.g. an EnvMapEquiRect, which would need asin and atan2
+// per lookup, or an EnvMapCube with six separate textures) is resampled into
+// a cube map with all six faces and their mip levels in one contiguous array.
+// Finding the texel for a direction only needs a few divisions. The faces use
+// the same orientation as EnvMapCube.
+// The source is sampled only at the time given to the constructor, so maps
+// whose values change over time must not be prepared.
+class EnvMapPrepared : public EnvMap
+{
+public:
+    std::vector<int> sizes;     // per mip level: the face size in texels
+    std::vector<size_t> offsets;// per mip level: index of the first texel
+    std::vector<vec3> texels;   // per level, per face, per row, per column
+
+    EnvMapPrepared(const EnvMap& source, int faceSize, float t = 0.0f)
+    {
+        sizes.push_back(faceSize);
+        offsets.push_back(0);
+        texels.resize(6 * size_t(faceSize) * faceSize);
+        #pragma omp parallel for collapse(2)
+        for (int f = 0; f < 6; f++) {
+            for (int y = 0; y < faceSize; y++) {
+                for (int x = 0; x < faceSize; x++) {
+                    vec3 d = direction(f, (x + 0.5f) / faceSize, (y + 0.5f) / faceSize);
+                    texels[(size_t(f) * faceSize + y) * faceSize + x] = source.value(d, t);
+                }
+            }
+        }
+        while (sizes.back() > 1) {
+            int s = sizes.back();
+            size_t offset = offsets.back();
+            offsets.push_back(texels.size());
+            for (int f = 0; f < 6; f++) {
+                std::vector<vec3> face(texels.begin() + offset + size_t(f) * s * s,
+                        texels.begin() + offset + size_t(f + 1) * s * s);
+                int w, h;
+                std::vector<vec3> level = downsample(face, s, s, w, h);
+                texels.insert(texels.end(), level.begin(), level.end());
+            }
+            sizes.push_back(std::max(1, s / 2));
+        }
+    }
+
+    // The direction of the point (u,v) in [0,1]^2 on a cube face
+    static vec3 direction(int face, float u, float v)
+    {
+        float a = 2.0f * u - 1.0f;
+        float b = 2.0f * v - 1.0f;
+        vec3 d;
+        switch (face) {
+        case 0: d = vec3(+1.0f, b, -a); break;
+        case 1: d = vec3(-1.0f, b, +a); break;
+        case 2: d = vec3(a, +1.0f, -b); break;
+        case 3: d = vec3(a, -1.0f, +b); break;
+        case 4: d = vec3(a, b, +1.0f); break;
+        default: d = vec3(-a, b, -1.0f); break;
+        }
+        return normalize(d);
+    }
+
+    // The cube face and the point (u,v) on it for a direction
+    static int face(const vec3& direction, float& u, float& v)
+    {
+        float ax = std::abs(direction.x());
+        float ay = std::abs(direction.y());
+        float az = std::abs(direction.z());
+        if (ax > ay && ax > az) {
+            u = 0.5f * (direction.z() / -direction.x() + 1.0f);
+            v = 0.5f * (direction.y() / ax + 1.0f);
+            return 0 + std::signbit(direction.x());
+        } else if (ay > az) {
+            u = 0.5f * (direction.x() / ay + 1.0f);
+            v = 0.5f * (direction.z() / -direction.y() + 1.0f);
+            return 2 + std::signbit(direction.y());
+        } else {
+            u = 0.5f * (direction.x() / direction.z() + 1.0f);
+            v = 0.5f * (direction.y() / az + 1.0f);
+            return 4 + std::signbit(direction.z());
+        }
+    }
+
+    // Bilinear interpolation on one face of one mip level; the texels at the
+    // face borders are repeated
+    vec3 bilinear(int level, int f, float u, float v) const
+    {
+        int s = sizes[level];
+        const vec3* data = texels.data() + offsets[level] + size_t(f) * s * s;
+        float x = std::min(std::max(u * s - 0.5f, 0.0f), s - 1.0f);
+        float y = std::min(std::max(v * s - 0.5f, 0.0f), s - 1.0f);
+        int x0 = x;
+        int y0 = y;
+        int x1 = std::min(x0 + 1, s - 1);
+        int y1 = std::min(y0 + 1, s - 1);
+        float ax = x - x0;
+        float ay = y - y0;
+        vec3 a = mix(data[y0 * s + x0], data[y0 * s + x1], ax);
+        vec3 b = mix(data[y1 * s + x0], data[y1 * s + x1], ax);
+        return mix(a, b, ay);
+    }
+
+    virtual vec3 value(const vec3& direction, float /* t */) const override
+    {
+        float u, v;
+        int f = face(direction, u, v);
+        return bilinear(0, f, u, v);
+    }
+
+    virtual vec3 filteredValue(const vec3& direction, float footprint, float t) const override
+    {
+        // a texel of level 0 covers about (pi/2)/faceSize radians
+        float level = std::log2(std::max(footprint * sizes[0] / (0.5f * pi), 1.0f));
+        if (level <= 0.0f)
+            return value(direction, t);
+        float u, v;
+        int f = face(direction, u, v);
+        int maxLevel = sizes.size() - 1;
+        if (level >= maxLevel)
+            return bilinear(maxLevel, f, u, v);
+        int l0 = level;
+        return mix(bilinear(l0, f, u, v), bilinear(l0 + 1, f, u, v), level - l0);
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addArray(sizes.data(), sizes.size());
+        hasher.addArray(texels.data(), texels.size());
+    }
+};
+
+// Resample an environment map into an equirectangular image for
+// EnvMapEquiRect, e.g. to convert a cube map
+inline std::vector<vec3> envMapToEquiRect(const EnvMap& source, int width, int height, float t = 0.0f)
+{
+    std::vector<vec3> img(size_t(width) * height);
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        float theta = pi * ((y + 0.5f) / height - 0.5f);
+        for (int x = 0; x < width; x++) {
+            float phi = 2.0f * pi * (x + 0.5f) / width;
+            vec3 d(-std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
+            img[size_t(y) * width + x] = source.value(d, t);
+        }
+    }
+    return img;
+}
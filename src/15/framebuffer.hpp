@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "math.hpp"
+#include "color.hpp"
+
+// Accumulates the radiance samples of each pixel. Additionally, the running
+// mean and variance of the luminance of the samples are computed with
+// Welford's algorithm, so that the error of each pixel can be estimated.
+class Framebuffer
+{
+public:
+    int width, height;
+    std::vector<vec3> sum;              // sum of the radiance samples
+    std::vector<float> mean;            // running mean of the luminance
+    std::vector<float> m2;              // running sum of squared luminance differences
+    std::vector<unsigned int> samples;  // number of samples
+
+    Framebuffer(int w, int h) :
+        width(w), height(h),
+        sum(w * h, vec3(0.0f)), mean(w * h, 0.0f), m2(w * h, 0.0f), samples(w * h, 0)
+    {
+    }
+
+    static float luminance(const vec3& rgb)
+    {
+        return 0.01f * rgb_to_xyz(rgb).y();
+    }
+
+    void add(int i, const vec3& radiance)
+    {
+        float l = luminance(radiance);
+        samples[i]++;
+        sum[i] += radiance;
+        float delta = l - mean[i];
+        mean[i] += delta / samples[i];
+        m2[i] += delta * (l - mean[i]);
+    }
+
+    vec3 value(int i) const
+    {
+        return samples[i] > 0 ? sum[i] / samples[i] : vec3(0.0f);
+    }
+
+    // sample variance of the luminance
+    float variance(int i) const
+    {
+        return samples[i] > 1 ? m2[i] / (samples[i] - 1) : 0.0f;
+    }
+
+    // standard error of the mean luminance, relative to the mean luminance;
+    // the epsilon avoids giving too much weight to very dark pixels
+    float relativeError(int i) const
+    {
+        const float epsilon = 0.01f;
+        if (samples[i] < 2)
+            return std::numeric_limits<float>::max();
+        return std::sqrt(variance(i) / samples[i]) / (std::abs(mean[i]) + epsilon);
+    }
+
+    // Copy a rectangular region into a new framebuffer, e.g. so that a thread
+    // can accumulate samples into a tile without touching shared cache lines
+    Framebuffer crop(int x0, int y0, int w, int h) const
+    {
+        Framebuffer fb(w, h);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                int i = y * w + x;
+                int j = (y0 + y) * width + (x0 + x);
+                fb.sum[i] = sum[j];
+                fb.mean[i] = mean[j];
+                fb.m2[i] = m2[j];
+                fb.samples[i] = samples[j];
+            }
+        }
+        return fb;
+    }
+
+    // Copy a framebuffer into a rectangular region; the inverse of crop()
+    void paste(const Framebuffer& fb, int x0, int y0)
+    {
+        for (int y = 0; y < fb.height; y++) {
+            for (int x = 0; x < fb.width; x++) {
+                int i = y * fb.width + x;
+                int j = (y0 + y) * width + (x0 + x);
+                sum[j] = fb.sum[i];
+                mean[j] = fb.mean[i];
+                m2[j] = fb.m2[i];
+                samples[j] = fb.samples[i];
+            }
+        }
+    }
+
+    std::vector<vec3> image() const
+    {
+        std::vector<vec3> img(width * height);
+        for (int i = 0; i < width * height; i++)
+            img[i] = value(i);
+        return img;
+    }
+
+    std::vector<vec3> varianceImage() const
+    {
+        std::vector<vec3> img(width * height);
+        for (int i = 0; i < width * height; i++)
+            img[i] = vec3(variance(i));
+        return img;
+    }
+
+    std::vector<vec3> samplesImage() const
+    {
+        std::vector<vec3> img(width * height);
+        for (int i = 0; i < width * height; i++)
+            img[i] = vec3(samples[i]);
+        return img;
+    }
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+// Incremental FNV-1a hash, used to identify the scene and the render
+// parameters that a checkpoint belongs to.
+class Hasher
+{
+public:
+    uint64_t h;
+    std::map<const void*, uint64_t> objects;    // see addObject()
+
+    Hasher() : h(0xcbf29ce484222325u)
+    {
+    }
+
+    void addBytes(const void* data, size_t size)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            h ^= p[i];
+            h *= 0x100000001b3u;
+        }
+    }
+
+    template<typename T> void add(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        addBytes(&value, sizeof(T));
+    }
+
+    template<typename T> void addArray(const T* data, size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        add(n);
+        addBytes(data, n * sizeof(T));
+    }
+
+    // Add a scene object (e.g. a texture) with its hash() function. An object
+    // that is referenced several times is only hashed once; later references
+    // add its number, so the hash does not depend on addresses.
+    template<typename T> void addObject(const T* object)
+    {
+        if (!object) {
+            add(~uint64_t(0));
+            return;
+        }
+        auto it = objects.find(object);
+        if (it != objects.end()) {
+            add(it->second);
+        } else {
+            uint64_t n = objects.size();
+            objects.insert(std::make_pair(object, n));
+            add(n);
+            object->hash(*this);
+        }
+    }
+};
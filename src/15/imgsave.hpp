@@ -3,6 +3,8 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <cstdio>
+#include <cstring>
 
 #include "math.hpp"
 
@@ -36,3 +38,23 @@ bool saveImageAsPPM(const std::string& fileName, const std::vector<unsigned char
     ofs.close();
     return ok;
 }
+
+// Load a floating point image in PFM format as written by saveImageAsPfm
+bool loadImageFromPfm(const std::string& fileName, std::vector<vec3>& img, int& width, int& height)
+{
+    FILE* f = fopen(fileName.c_str(), "rb");
+    if (!f)
+        return false;
+    char magic[3] = { 0, 0, 0 };
+    float scaleFactor = 0.0f;
+    bool ok = fscanf(f, "%2s %d %d %f", magic, &width, &height, &scaleFactor) == 4
+        && std::strcmp(magic, "PF") == 0 && width > 0 && height > 0
+        && scaleFactor < 0.0f /* little endian */
+        && fgetc(f) == '\n';
+    if (ok) {
+        img.resize(size_t(width) * height);
+        ok = fread(img.data(), sizeof(vec3), img.size(), f) == img.size();
+    }
+    fclose(f);
+    return ok;
+}
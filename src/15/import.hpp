@@ -2,6 +2,7 @@
 
 #include <cstdio>
 #include <map>
+#include <unordered_map>
 
 #include "scene.hpp"
 #include "material_light.hpp"
@@ -19,6 +20,8 @@
 #endif
 
 #include "tiny_obj_loader.h"
+#include "import_obj.hpp"
+#include "scene_cache.hpp"
 
 /* Helper function to get the base directory (for loading textures) */
 inline std::string baseDir(const std::string& fileName)
@@ -43,58 +46,167 @@ inline std::string fixFileName(const std::string& fileName)
     return fixedName;
 }
 
-/* Helper function to convert a bump map to a normal map */
-inline Texture* bumpMapToNormalMap(const Texture* bumpMap, float bumpFactor, int w, int h)
+/* Helper function to convert a bump map to a normal map. The heights are read
+ * directly from the texels (repeating the edge texels at the borders), and the
+ * rows are converted in parallel. */
+inline TextureImage* bumpMapToNormalMap(const TextureImage& bumpMap, float bumpFactor)
 {
-    float texelW = 1.0f / w;
-    float texelH = 1.0f / h;
-    std::vector<vec3> normalMap(w * h);
+    int w = bumpMap.width;
+    int h = bumpMap.height;
+    std::vector<float> heights(size_t(w) * h);
+    std::vector<vec3> normalMap(size_t(w) * h);
+    #pragma omp taskloop shared(bumpMap, heights)
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            heights[size_t(y) * w + x] = bumpMap.texel(0, x, y).x();
+    #pragma omp taskloop shared(heights, normalMap)
     for (int y = 0; y < h; y++) {
-        float v = (y + 0.5f) / h;
+        const float* row = heights.data() + size_t(y) * w;
+        const float* rowT = heights.data() + size_t(std::min(y + 1, h - 1)) * w;
+        const float* rowB = heights.data() + size_t(std::max(y - 1, 0)) * w;
+        vec3* normals = normalMap.data() + size_t(y) * w;
+        #pragma omp simd
         for (int x = 0; x < w; x++) {
-            float u = (x + 0.5f) / w;
-            float heightT = bumpMap->value(vec2(u, std::min(1.0f, v + texelH)), 0.0f).x();
-            float heightB = bumpMap->value(vec2(u, std::max(0.0f, v - texelH)), 0.0f).x();
-            float heightL = bumpMap->value(vec2(std::max(0.0f, u - texelW), v), 0.0f).x();
-            float heightR = bumpMap->value(vec2(std::min(1.0f, u + texelW), v), 0.0f).x();
-            vec3 tx = vec3(2.0, 0.0, bumpFactor * (heightR - heightL));
-            vec3 ty = vec3(0.0, 2.0, bumpFactor * (heightT - heightB));
-            vec3 n = normalize(cross(tx, ty));
-            normalMap[y * w + x] = 0.5f * (n + vec3(1.0f));
+            float dx = bumpFactor * (row[std::min(x + 1, w - 1)] - row[std::max(x - 1, 0)]);
+            float dy = bumpFactor * (rowT[x] - rowB[x]);
+            // normalize(cross(vec3(2, 0, dx), vec3(0, 2, dy))), mapped to [0,1]
+            float s = 0.5f / std::sqrt(4.0f * dx * dx + 4.0f * dy * dy + 16.0f);
+            normals[x] = vec3(0.5f - 2.0f * dx * s, 0.5f - 2.0f * dy * s, 0.5f + 4.0f * s);
         }
     }
-    return new TextureImage(normalMap, w, h);
+    return new TextureImage(normalMap, w, h, TexelHalf);
 }
 
-/* Helper function to import a texture image */
+/* Helper function to import a texture image. If a texture cache is given,
+ * the image is only decoded when its tiled file needs to be created.
+ * This function may be called from several threads at the same time. */
 inline Texture* importTexture(const std::string& basedir, const std::string& fileName,
-        std::map<std::string, Texture*>& textureMap,
         bool linearizeLDR = true,
-        float bumpFactor = -1.0f)
+        float bumpFactor = -1.0f,
+        TextureCache* textureCache = nullptr)
 {
-    auto it = textureMap.find(fileName);
-    if (it != textureMap.end()) {
-        fprintf(stderr, "    texture %s: found in cache\n", fileName.c_str());
-        return it->second;
-    } else {
-        fprintf(stderr, "    texture %s: creating\n", fileName.c_str());
-        std::string realFileName = basedir + IMPORT_DIR_SEP + fixFileName(fileName);
-        Texture* tex;
-        int w, h, n;
-        if (!stbi_info(realFileName.c_str(), &w, &h, &n)) {
-            fprintf(stderr, "    texture %s: cannot read; replaced with dummy\n", fileName.c_str());
-            tex = new TextureConstant(vec3(0.5f));
+    std::string realFileName = basedir + IMPORT_DIR_SEP + fixFileName(fileName);
+    int w, h, n;
+    if (!stbi_info(realFileName.c_str(), &w, &h, &n)) {
+        fprintf(stderr, "    texture %s: cannot read; replaced with dummy\n", fileName.c_str());
+        return new TextureConstant(vec3(0.5f));
+    }
+    auto decode = [&]() {
+        if (bumpFactor > 0.0f) {
+            TextureImage bumpMap(realFileName, linearizeLDR);
+            return std::unique_ptr<TextureImage>(bumpMapToNormalMap(bumpMap, bumpFactor));
+        } else {
+            return std::make_unique<TextureImage>(realFileName, linearizeLDR);
+        }
+    };
+    int id = -1;
+    if (textureCache) {
+        std::string variant = std::string(linearizeLDR ? "linear" : "raw")
+            + (bumpFactor > 0.0f ? " bump " + std::to_string(bumpFactor) : std::string());
+        id = textureCache->open(realFileName, variant, decode);
+        if (id < 0)
+            fprintf(stderr, "    texture %s: cannot cache; loading it completely\n", fileName.c_str());
+    }
+    if (id >= 0)
+        return new TextureTiled(textureCache, id);
+    TextureImage* img = decode().release();
+    fprintf(stderr, "    texture %s: %dx%d, %d channels, %zu KiB with mipmaps\n", fileName.c_str(),
+            img->width, img->height, img->channels, img->memory() / 1024);
+    return img;
+}
+
+/* Helper class to hash the index triple of a face corner */
+class ObjIndexHash
+{
+public:
+    size_t operator()(const ObjIndex& i) const
+    {
+        size_t h = static_cast<unsigned int>(i.v);
+        h = h * 0x9e3779b97f4a7c15u + static_cast<unsigned int>(i.vt);
+        h = h * 0x9e3779b97f4a7c15u + static_cast<unsigned int>(i.vn);
+        return h ^ (h >> 29);
+    }
+};
+
+class ObjIndexEqual
+{
+public:
+    bool operator()(const ObjIndex& a, const ObjIndex& b) const
+    {
+        return a.v == b.v && a.vt == b.vt && a.vn == b.vn;
+    }
+};
+
+/* Helper function to collect all geometry that uses the given material into
+ * one mesh, or nullptr if there is none. Quads are split along their shorter
+ * diagonal, larger polygons into fans. The material of the mesh is set by the
+ * caller. */
+inline Mesh* importMesh(const ObjFile& obj, int matId, const Animation* anim)
+{
+    size_t cornerCount = 0;
+    for (size_t c = 0; c < obj.faces.size(); c++)
+        cornerCount += obj.faces[c][matId + 1].corners.size();
+    if (cornerCount == 0)
+        return nullptr;
+    std::unordered_map<ObjIndex, unsigned int, ObjIndexHash, ObjIndexEqual> indexMap;
+    indexMap.reserve(cornerCount);
+    std::vector<vec3> positions;
+    std::vector<vec3> normals;
+    std::vector<vec2> texcoords;
+    std::vector<unsigned int> indices;
+    indices.reserve(3 * cornerCount);
+    bool haveNormals = true;
+    bool haveTexCoords = true;
+    auto addCorner = [&](const ObjIndex& index) {
+        auto it = indexMap.find(index);
+        if (it == indexMap.end()) {
+            unsigned int newIndex = positions.size();
+            positions.push_back(obj.positions[index.v]);
+            if (index.vn < 0)
+                haveNormals = false;
+            if (index.vt < 0)
+                haveTexCoords = false;
+            if (haveNormals) {
+                // do not trust normals to be of unit length: normalize!
+                normals.push_back(normalize(obj.normals[index.vn]));
+            }
+            if (haveTexCoords) {
+                texcoords.push_back(obj.texcoords[index.vt]);
+            }
+            indices.push_back(newIndex);
+            indexMap.insert(std::make_pair(index, newIndex));
         } else {
-            if (bumpFactor > 0.0f) {
-                TextureImage bumpMap(realFileName, linearizeLDR);
-                tex = bumpMapToNormalMap(&bumpMap, bumpFactor, w, h);
+            indices.push_back(it->second);
+        }
+    };
+    for (size_t c = 0; c < obj.faces.size(); c++) {
+        const ObjFaces& F = obj.faces[c][matId + 1];
+        const ObjIndex* face = F.corners.data();
+        for (size_t f = 0; f < F.sizes.size(); f++) {
+            int n = F.sizes[f];
+            if (n == 4) {
+                // split along the shorter diagonal, like TinyObjLoader
+                vec3 d02 = obj.positions[face[2].v] - obj.positions[face[0].v];
+                vec3 d13 = obj.positions[face[3].v] - obj.positions[face[1].v];
+                const int split[2][6] = { { 0, 1, 2, 0, 2, 3 }, { 0, 1, 3, 1, 2, 3 } };
+                const int* s = split[dot(d02, d02) < dot(d13, d13) ? 0 : 1];
+                for (int i = 0; i < 6; i++)
+                    addCorner(face[s[i]]);
             } else {
-                tex = new TextureImage(realFileName, linearizeLDR);
+                for (int i = 1; i < n - 1; i++) {
+                    addCorner(face[0]);
+                    addCorner(face[i]);
+                    addCorner(face[i + 1]);
+                }
             }
+            face += n;
         }
-        textureMap.insert(std::pair<std::string, Texture*>(fileName, tex));
-        return tex;
     }
+    if (!haveNormals)
+        normals.clear();
+    if (!haveTexCoords)
+        texcoords.clear();
+    return new Mesh(std::move(positions), std::move(normals), std::move(texcoords), std::move(indices), nullptr, anim);
 }
 
 /* Helper function to split a multiline TinyObjLoader message */
@@ -118,49 +230,77 @@ inline std::vector<std::string> tinyObjMsgToLines(const std::string& s)
 inline bool importIntoScene(Scene& scene, const std::string& fileName, const Animation* anim = nullptr)
 {
     fprintf(stderr, "%s: importing...\n", fileName.c_str());
-    tinyobj::ObjReaderConfig conf;
-    conf.triangulate = true;
-    conf.vertex_color = false;
-    tinyobj::ObjReader reader;
-    reader.ParseFromFile(fileName, conf);
-    if (reader.Warning().size() > 0) {
-        std::vector<std::string> lines = tinyObjMsgToLines(reader.Warning());
-        for (size_t i = 0; i < lines.size(); i++)
-            fprintf(stderr, "  warning: %s\n", lines[i].c_str());
-    }
-    if (!reader.Valid()) {
-        if (reader.Error().size() > 0) {
-            std::vector<std::string> lines = tinyObjMsgToLines(reader.Error());
-            for (size_t i = 0; i < lines.size(); i++)
-                fprintf(stderr, "  error: %s\n", lines[i].c_str());
-        } else {
-            fprintf(stderr, "  unknown error\n");
+    SceneCache* sceneCache = scene.sceneCache.get();
+    std::unique_ptr<SceneCache::Entry> cached;
+    if (sceneCache)
+        cached = sceneCache->open(fileName, anim);
+    ObjFile obj;
+    if (cached) {
+        fprintf(stderr, "  using the scene cache\n");
+    } else {
+        bool valid = obj.read(fileName);
+        for (size_t i = 0; i < obj.warnings.size(); i++) {
+            std::vector<std::string> lines = tinyObjMsgToLines(obj.warnings[i] + '\n');
+            for (size_t j = 0; j < lines.size(); j++)
+                fprintf(stderr, "  warning: %s\n", lines[j].c_str());
+        }
+        if (!valid) {
+            fprintf(stderr, "  error: %s\n", obj.error.c_str());
+            fprintf(stderr, "%s: import failure\n", fileName.c_str());
+            return false;
         }
-        fprintf(stderr, "%s: import failure\n", fileName.c_str());
-        return false;
     }
-    const std::vector<tinyobj::material_t>& objMaterials = reader.GetMaterials();
+    const std::vector<tinyobj::material_t>& objMaterials = (cached ? cached->materials : obj.materials);
     std::string basedir = baseDir(fileName);
 
-    /* Create the materials */
+    /* Choose the material models and collect the textures they need */
 
-    std::vector<Material*> materials;
+    // the textures of a material, as indices into the texture list (or -1)
+    class MaterialTextures
+    {
+    public:
+        int kd = -1, ks = -1, s = -1, opacity = -1, normal = -1;
+    };
+    class TextureRequest
+    {
+    public:
+        std::string fileName;
+        TextureKey key;
+        Texture* texture;   // set before decoding if the registry has it already
+        bool decoded;
+    };
+    std::vector<TextureRequest> textureRequests;
+    std::map<TextureKey, int> textureMap;
+    auto requestTexture = [&](const std::string& texName, bool linearizeLDR, float bumpFactor = -1.0f) {
+        std::string realFileName = basedir + IMPORT_DIR_SEP + fixFileName(texName);
+        TextureKey key = scene.textureRegistry.key(realFileName, linearizeLDR, bumpFactor);
+        auto it = textureMap.find(key);
+        if (key.content >= 0 && it != textureMap.end()) {
+            fprintf(stderr, "    texture %s: found in cache\n", texName.c_str());
+            return it->second;
+        }
+        Texture* tex = scene.textureRegistry.find(key);
+        fprintf(stderr, "    texture %s: %s\n", texName.c_str(), tex ? "shared with an earlier import" : "creating");
+        textureMap.insert(std::make_pair(key, int(textureRequests.size())));
+        textureRequests.push_back(TextureRequest { texName, key, tex, false });
+        return int(textureRequests.size()) - 1;
+    };
     std::vector<bool> materialIsLight;
-    std::map<std::string, Texture*> textureMap;
+    std::vector<bool> materialIsPhong;
+    std::vector<MaterialTextures> materialTextures(objMaterials.size());
     for (size_t i = 0; i < objMaterials.size(); i++) {
         // get parameters
         const tinyobj::material_t& M = objMaterials[i];
         fprintf(stderr, "  material '%s'...\n", M.name.c_str());
-        vec3 dif = vec3(M.diffuse);
         vec3 spc = vec3(M.specular);
         vec3 emi = vec3(M.emission);
-        float shi = M.shininess;
+        MaterialTextures& T = materialTextures[i];
         // check which material model to use
         if (dot(emi, emi) > 0.0f) {
             // this is a light source
             fprintf(stderr, "    using Light material model\n");
-            materials.push_back(new MaterialLight(emi));
             materialIsLight.push_back(true);
+            materialIsPhong.push_back(false);
         } else if (dot(spc, spc) <= 0.0f
                 && M.specular_texname.size() == 0
                 && M.alpha_texname.size() == 0
@@ -168,66 +308,105 @@ inline bool importIntoScene(Scene& scene, const std::string& fileName, const Ani
                 && M.bump_texname.size() == 0) {
             // no specular or opacity parts; assume MaterialLambertian
             fprintf(stderr, "    using Lambertian material model\n");
-            Texture* tex;
-            if (M.diffuse_texname.size() > 0) {
-                tex = importTexture(basedir, M.diffuse_texname, textureMap);
-            } else {
-                tex = new TextureConstant(dif);
-            }
-            materials.push_back(new MaterialLambertian(tex));
+            if (M.diffuse_texname.size() > 0)
+                T.kd = requestTexture(M.diffuse_texname, true);
             materialIsLight.push_back(false);
+            materialIsPhong.push_back(false);
         } else {
             // MaterialPhong
             fprintf(stderr, "    using Phong material model\n");
-            Texture* texKd;
-            Texture* texKs;
-            Texture* texS;
-            Texture* texOpacity;
-            Texture* texNormal;
-            if (M.diffuse_texname.size() > 0) {
-                texKd = importTexture(basedir, M.diffuse_texname, textureMap);
-            } else {
-                texKd = new TextureConstant(dif);
-            }
-            if (M.specular_texname.size() > 0) {
-                texKs = importTexture(basedir, M.specular_texname, textureMap);
-            } else {
-                texKs = new TextureConstant(spc);
-            }
-            if (M.specular_highlight_texname.size() > 0) {
-                texS = importTexture(basedir, M.specular_highlight_texname, textureMap);
-            } else {
-                texS = new TextureConstant(vec3(shi));
-            }
-            if (M.alpha_texname.size() > 0) {
-                texOpacity = importTexture(basedir, M.alpha_texname, textureMap);
-            } else {
-                texOpacity = nullptr;
-            }
-            if (M.normal_texname.size() > 0) {
-                texNormal = importTexture(basedir, M.normal_texname, textureMap, false);
-            } else if (M.bump_texname.size() > 0) {
-                texNormal = importTexture(basedir, M.bump_texname, textureMap, false,
-                        M.bump_texopt.bump_multiplier);
-            } else {
-                texNormal = nullptr;
-            }
-            materials.push_back(new MaterialPhong(texKd, texKs, texS, texOpacity, texNormal));
+            if (M.diffuse_texname.size() > 0)
+                T.kd = requestTexture(M.diffuse_texname, true);
+            if (M.specular_texname.size() > 0)
+                T.ks = requestTexture(M.specular_texname, true);
+            if (M.specular_highlight_texname.size() > 0)
+                T.s = requestTexture(M.specular_highlight_texname, true);
+            if (M.alpha_texname.size() > 0)
+                T.opacity = requestTexture(M.alpha_texname, true);
+            if (M.normal_texname.size() > 0)
+                T.normal = requestTexture(M.normal_texname, false);
+            else if (M.bump_texname.size() > 0)
+                T.normal = requestTexture(M.bump_texname, false, M.bump_texopt.bump_multiplier);
             materialIsLight.push_back(false);
+            materialIsPhong.push_back(true);
+        }
+    }
+
+    /* Import the textures and the meshes */
+
+    // Each texture and the geometry of each material is imported by its
+    // own task, so that the mesh assembly overlaps with texture decoding.
+    // Collect all geometry with the same material into one Mesh, unless the
+    // meshes come from the scene cache.
+    size_t newTextures = 0;
+    for (size_t i = 0; i < textureRequests.size(); i++)
+        newTextures += (textureRequests[i].texture ? 0 : 1);
+    if (cached)
+        fprintf(stderr, "  importing %zu textures\n", newTextures);
+    else
+        fprintf(stderr, "  importing %zu textures and %zu vertices\n", newTextures, obj.positions.size());
+    std::vector<Mesh*> meshes(objMaterials.size() + 1); // index 0: no material
+    if (cached)
+        meshes = std::move(cached->meshes);
+    TextureCache* textureCache = scene.textureCache.get();
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for (size_t i = 0; i < textureRequests.size(); i++) {
+            if (textureRequests[i].texture)
+                continue;
+            #pragma omp task
+            {
+                TextureRequest& R = textureRequests[i];
+                R.texture = importTexture(basedir, R.fileName, R.key.linearizeLDR, R.key.bumpFactor, textureCache);
+                R.decoded = true;
+            }
+        }
+        for (int matId = -1; !cached && matId < static_cast<int>(objMaterials.size()); matId++) {
+            #pragma omp task
+            meshes[matId + 1] = importMesh(obj, matId, anim);
+        }
+    }
+    if (sceneCache && !cached) {
+        std::vector<std::string> sourceFileNames(1, fileName);
+        sourceFileNames.insert(sourceFileNames.end(), obj.materialFiles.begin(), obj.materialFiles.end());
+        if (!sceneCache->write(sourceFileNames, objMaterials, meshes))
+            fprintf(stderr, "  warning: cannot write the scene cache\n");
+    }
+
+    /* Create the materials */
+
+    std::vector<Material*> materials;
+    for (size_t i = 0; i < textureRequests.size(); i++) {
+        if (textureRequests[i].decoded) {
+            scene.take(textureRequests[i].texture);
+            scene.textureRegistry.add(textureRequests[i].key, textureRequests[i].texture);
+        }
+    }
+    for (size_t i = 0; i < objMaterials.size(); i++) {
+        const tinyobj::material_t& M = objMaterials[i];
+        const MaterialTextures& T = materialTextures[i];
+        auto texture = [&](int index, const vec3& value) -> Texture* {
+            return index >= 0 ? textureRequests[index].texture : new TextureConstant(value);
+        };
+        if (materialIsLight[i]) {
+            materials.push_back(new MaterialLight(vec3(M.emission)));
+        } else if (!materialIsPhong[i]) {
+            materials.push_back(new MaterialLambertian(texture(T.kd, vec3(M.diffuse))));
+        } else {
+            materials.push_back(new MaterialPhong(
+                        texture(T.kd, vec3(M.diffuse)),
+                        texture(T.ks, vec3(M.specular)),
+                        texture(T.s, vec3(M.shininess)),
+                        T.opacity >= 0 ? textureRequests[T.opacity].texture : nullptr,
+                        T.normal >= 0 ? textureRequests[T.normal].texture : nullptr));
         }
     }
-    for (auto it = textureMap.cbegin(); it != textureMap.cend(); it++)
-        scene.take(it->second);
     for (size_t i = 0; i < materials.size(); i++)
         scene.take(materials[i]);
 
-    /* Import the shapes */
+    /* Add the meshes to the scene, in the order of the materials */
 
-    // Collect all geometry with the same material into one single Mesh.
-    // So we loop over the materials, and for each material over all geometry.
-    const tinyobj::attrib_t& attrib = reader.GetAttrib();
-    const std::vector<tinyobj::shape_t>& shapes = reader.GetShapes();
-    fprintf(stderr, "  importing %zu shapes\n", shapes.size());
     Texture* nullTexture = scene.take(new TextureConstant(vec3(0.5f)));
     Material* nullMaterial = scene.take(new MaterialLambertian(nullTexture));
     for (int matId = -1; matId < static_cast<int>(materials.size()); matId++) {
@@ -236,55 +415,11 @@ inline bool importIntoScene(Scene& scene, const std::string& fileName, const Ani
         } else {
             fprintf(stderr, "  importing all geometry that uses material '%s'\n", objMaterials[matId].name.c_str());
         }
-        for (size_t s = 0; s < shapes.size(); s++) {
-            std::map<std::tuple<int, int, int>, unsigned int> indexTupleMap;
-            std::vector<vec3> positions;
-            std::vector<vec3> normals;
-            std::vector<vec2> texcoords;
-            std::vector<unsigned int> indices;
-            bool haveNormals = true;
-            bool haveTexCoords = true;
-            const tinyobj::mesh_t& mesh = shapes[s].mesh;
-            for (size_t i = 0; i < mesh.indices.size(); i++) {
-                size_t triangleIndex = i / 3;
-                if (mesh.material_ids[triangleIndex] == matId) {
-                    const tinyobj::index_t& index = mesh.indices[i];
-                    int vi = index.vertex_index;
-                    int ni = index.normal_index;
-                    int ti = index.texcoord_index;
-                    std::tuple<int, int, int> indexTuple = std::make_tuple(vi, ni, ti);
-                    auto it = indexTupleMap.find(indexTuple);
-                    if (it == indexTupleMap.end()) {
-                        unsigned int newIndex = indexTupleMap.size();
-                        positions.push_back(vec3(attrib.vertices.data() + 3 * vi));
-                        if (ni < 0)
-                            haveNormals = false;
-                        if (ti < 0)
-                            haveTexCoords = false;
-                        if (haveNormals) {
-                            vec3 n = vec3(attrib.normals.data() + 3 * ni);
-                            // do not trust normals to be of unit length: normalize!
-                            normals.push_back(normalize(n));
-                        }
-                        if (haveTexCoords) {
-                            texcoords.push_back(vec2(attrib.texcoords.data() + 2 * ti));
-                        }
-                        indices.push_back(newIndex);
-                        indexTupleMap.insert(std::make_pair(indexTuple, newIndex));
-                    } else {
-                        indices.push_back(it->second);
-                    }
-                }
-            }
-            if (indices.size() == 0)
-                continue;
-            if (!haveNormals)
-                normals.clear();
-            if (!haveTexCoords)
-                texcoords.clear();
-            Material* mat = (matId < 0 ? nullMaterial : materials[matId]);
-            bool isLight = (matId >= 0 && materialIsLight[matId]);
-            scene.take(new Mesh(positions, normals, texcoords, indices, mat, anim), isLight);
+        Material* mat = (matId < 0 ? nullMaterial : materials[matId]);
+        bool isLight = (matId >= 0 && materialIsLight[matId]);
+        if (meshes[matId + 1]) {
+            meshes[matId + 1]->material = mat;
+            scene.take(meshes[matId + 1], isLight);
         }
     }
 
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "math.hpp"
+#include "tiny_obj_loader.h"
+
+// The indices of one face corner into ObjFile::positions, texcoords, and
+// normals; -1 if missing
+class ObjIndex
+{
+public:
+    int v, vt, vn;
+};
+
+// The faces of one part of an OBJ file that use the same material
+class ObjFaces
+{
+public:
+    std::vector<int> sizes;             // number of corners per face
+    std::vector<ObjIndex> corners;
+};
+
+// Reads the geometry of an OBJ file in parallel. The file is memory mapped
+// and split into chunks of whole lines. A first parallel pass counts the
+// vertex data of each chunk and finds its material libraries and its last
+// material; a second parallel pass parses the chunks, writing vertex data
+// directly to its final place and sorting the faces by material. Materials
+// are read with TinyObjLoader.
+class ObjFile
+{
+public:
+    std::vector<vec3> positions;
+    std::vector<vec3> normals;
+    std::vector<vec2> texcoords;
+    std::vector<tinyobj::material_t> materials;
+    std::vector<std::string> materialFiles;     // the MTL files that were read
+    // faces[c][m]: the faces of chunk c that use material m - 1 (m == 0: none)
+    std::vector<std::vector<ObjFaces>> faces;
+    std::vector<std::string> warnings;
+    std::string error;
+
+    // Per chunk results of the first pass
+    class ChunkInfo
+    {
+    public:
+        const char* begin;
+        const char* end;
+        size_t v, vt, vn;               // numbers of vertex data lines
+        std::string lastMaterial;       // the last usemtl, if any
+        bool hasMaterial;
+        std::vector<std::string> materialLibs;
+        size_t invalidLines;
+    };
+
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char* skipSpace(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    static const char* lineEnd(const char* p, const char* end)
+    {
+        const char* e = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        return e ? e : end;
+    }
+
+    // the keyword at the start of a line, e.g. "v" or "usemtl"
+    static bool keyword(const char* p, const char* end, const char* kw, const char*& rest)
+    {
+        size_t n = std::strlen(kw);
+        if (size_t(end - p) < n || std::memcmp(p, kw, n) != 0 || (p + n < end && !isSpace(p[n])))
+            return false;
+        rest = p + n;
+        return true;
+    }
+
+    static std::string restOfLine(const char* p, const char* end)
+    {
+        p = skipSpace(p, end);
+        while (end > p && isSpace(end[-1]))
+            end--;
+        return std::string(p, end);
+    }
+
+    static bool parseFloat(const char*& p, const char* end, float& f)
+    {
+        p = skipSpace(p, end);
+        if (p < end && *p == '+')
+            p++;
+        std::from_chars_result r = std::from_chars(p, end, f);
+        if (r.ec != std::errc())
+            return false;
+        p = r.ptr;
+        return true;
+    }
+
+    static bool parseFloats(const char* p, const char* end, int n, float* f)
+    {
+        for (int i = 0; i < n; i++)
+            if (!parseFloat(p, end, f[i]))
+                return false;
+        return true;
+    }
+
+    // Parse an OBJ index (1-based, or negative relative to the count) to a
+    // 0-based index
+    static bool parseIndex(const char*& p, const char* end, size_t count, int& index)
+    {
+        int i;
+        std::from_chars_result r = std::from_chars(p, end, i);
+        if (r.ec != std::errc() || i == 0)
+            return false;
+        p = r.ptr;
+        long long j = (i > 0 ? i - 1 : static_cast<long long>(count) + i);
+        if (j < 0 || j >= static_cast<long long>(count))
+            return false;
+        index = j;
+        return true;
+    }
+
+    // Parse the corners of a face: v, v/vt, v//vn, or v/vt/vn
+    static bool parseFace(const char* p, const char* end, size_t v, size_t vt, size_t vn,
+            std::vector<ObjIndex>& corners)
+    {
+        corners.clear();
+        for (;;) {
+            p = skipSpace(p, end);
+            if (p == end)
+                break;
+            ObjIndex c { -1, -1, -1 };
+            if (!parseIndex(p, end, v, c.v))
+                return false;
+            if (p < end && *p == '/') {
+                p++;
+                if (p < end && *p != '/' && !isSpace(*p) && !parseIndex(p, end, vt, c.vt))
+                    return false;
+                if (p < end && *p == '/') {
+                    p++;
+                    if (!parseIndex(p, end, vn, c.vn))
+                        return false;
+                }
+            }
+            if (p < end && !isSpace(*p))
+                return false;
+            corners.push_back(c);
+        }
+        return corners.size() >= 3;
+    }
+
+    // First pass over a chunk
+    static void scanChunk(ChunkInfo& info)
+    {
+        info.v = info.vt = info.vn = 0;
+        info.hasMaterial = false;
+        info.invalidLines = 0;
+        for (const char* p = info.begin; p < info.end; ) {
+            const char* e = lineEnd(p, info.end);
+            const char* q = skipSpace(p, e);
+            const char* rest;
+            if (keyword(q, e, "v", rest))
+                info.v++;
+            else if (keyword(q, e, "vt", rest))
+                info.vt++;
+            else if (keyword(q, e, "vn", rest))
+                info.vn++;
+            else if (keyword(q, e, "usemtl", rest)) {
+                info.lastMaterial = restOfLine(rest, e);
+                info.hasMaterial = true;
+            } else if (keyword(q, e, "mtllib", rest))
+                info.materialLibs.push_back(restOfLine(rest, e));
+            p = e + 1;
+        }
+    }
+
+    // Second pass over a chunk; v, vt, vn are the numbers of vertex data
+    // lines before the chunk
+    void parseChunk(ChunkInfo& info, size_t v, size_t vt, size_t vn, int material,
+            const std::map<std::string, int>& materialMap, std::vector<ObjFaces>& chunkFaces,
+            std::vector<std::string>& unknownMaterials)
+    {
+        std::vector<ObjIndex> corners;
+        for (const char* p = info.begin; p < info.end; ) {
+            const char* e = lineEnd(p, info.end);
+            const char* q = skipSpace(p, e);
+            const char* rest;
+            float f[3];
+            if (keyword(q, e, "v", rest)) {
+                if (parseFloats(rest, e, 3, f))
+                    positions[v] = vec3(f[0], f[1], f[2]);
+                else
+                    info.invalidLines++;
+                v++;
+            } else if (keyword(q, e, "vt", rest)) {
+                if (parseFloats(rest, e, 2, f))
+                    texcoords[vt] = vec2(f[0], f[1]);
+                else
+                    info.invalidLines++;
+                vt++;
+            } else if (keyword(q, e, "vn", rest)) {
+                if (parseFloats(rest, e, 3, f))
+                    normals[vn] = vec3(f[0], f[1], f[2]);
+                else
+                    info.invalidLines++;
+                vn++;
+            } else if (keyword(q, e, "f", rest)) {
+                if (parseFace(rest, e, v, vt, vn, corners)) {
+                    ObjFaces& F = chunkFaces[material + 1];
+                    F.sizes.push_back(corners.size());
+                    F.corners.insert(F.corners.end(), corners.begin(), corners.end());
+                } else {
+                    info.invalidLines++;
+                }
+            } else if (keyword(q, e, "usemtl", rest)) {
+                std::string name = restOfLine(rest, e);
+                auto it = materialMap.find(name);
+                material = (it == materialMap.end() ? -1 : it->second);
+                if (it == materialMap.end())
+                    unknownMaterials.push_back(name);
+            }
+            p = e + 1;
+        }
+    }
+
+    bool read(const std::string& fileName)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            error = "cannot open " + fileName;
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+        size_t size = st.st_size;
+        const char* data = nullptr;
+        if (size > 0) {
+            void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m == MAP_FAILED) {
+                error = "cannot map " + fileName;
+                close(fd);
+                return false;
+            }
+            data = static_cast<const char*>(m);
+        }
+        close(fd);
+
+        // split into chunks of whole lines, several per thread
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        size_t chunkSize = std::max(size / (4 * threads) + 1, size_t(1) << 20);
+        std::vector<ChunkInfo> chunks;
+        for (const char* p = data; p < data + size; ) {
+            ChunkInfo info;
+            info.begin = p;
+            const char* e = std::min(p + chunkSize, data + size);
+            info.end = (e < data + size ? lineEnd(e, data + size) + 1 : e);
+            info.end = std::min(info.end, data + size);
+            chunks.push_back(info);
+            p = info.end;
+        }
+
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t c = 0; c < chunks.size(); c++)
+            scanChunk(chunks[c]);
+
+        // read the material libraries, in the order in which they appear
+        std::map<std::string, int> materialMap;
+        std::string basedir = baseDirectory(fileName);
+        tinyobj::MaterialFileReader materialReader(basedir);
+        for (size_t c = 0; c < chunks.size(); c++) {
+            for (size_t i = 0; i < chunks[c].materialLibs.size(); i++) {
+                // the first file of the list that can be read is used
+                const char* p = chunks[c].materialLibs[i].c_str();
+                const char* end = p + chunks[c].materialLibs[i].size();
+                bool found = false;
+                while (!found && (p = skipSpace(p, end)) < end) {
+                    const char* q = p;
+                    while (q < end && !isSpace(*q))
+                        q++;
+                    std::string warn, err;
+                    std::string name(p, q);
+                    found = materialReader(name, &materials, &materialMap, &warn, &err);
+                    if (found)
+                        materialFiles.push_back(basedir.empty() ? name : basedir + "/" + name);
+                    if (!warn.empty())
+                        warnings.push_back(warn);
+                    p = q;
+                }
+                if (!found)
+                    warnings.push_back("Failed to load material file(s). Use default material.");
+            }
+        }
+
+        // offsets of the vertex data and the material at the start of each chunk
+        std::vector<size_t> v(chunks.size() + 1, 0), vt(chunks.size() + 1, 0), vn(chunks.size() + 1, 0);
+        std::vector<int> startMaterial(chunks.size(), -1);
+        for (size_t c = 0; c < chunks.size(); c++) {
+            v[c + 1] = v[c] + chunks[c].v;
+            vt[c + 1] = vt[c] + chunks[c].vt;
+            vn[c + 1] = vn[c] + chunks[c].vn;
+            if (c > 0) {
+                startMaterial[c] = startMaterial[c - 1];
+                if (chunks[c - 1].hasMaterial) {
+                    auto it = materialMap.find(chunks[c - 1].lastMaterial);
+                    startMaterial[c] = (it == materialMap.end() ? -1 : it->second);
+                }
+            }
+        }
+        positions.resize(v.back());
+        texcoords.resize(vt.back());
+        normals.resize(vn.back());
+        faces.assign(chunks.size(), std::vector<ObjFaces>(materials.size() + 1));
+        std::vector<std::vector<std::string>> unknownMaterials(chunks.size());
+
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t c = 0; c < chunks.size(); c++)
+            parseChunk(chunks[c], v[c], vt[c], vn[c], startMaterial[c], materialMap, faces[c], unknownMaterials[c]);
+
+        if (data)
+            munmap(const_cast<char*>(data), size);
+
+        size_t invalidLines = 0;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            invalidLines += chunks[c].invalidLines;
+            for (size_t i = 0; i < unknownMaterials[c].size(); i++)
+                warnings.push_back("material [ '" + unknownMaterials[c][i] + "' ] not found in .mtl");
+        }
+        if (invalidLines > 0)
+            warnings.push_back(std::to_string(invalidLines) + " invalid lines ignored");
+        return true;
+    }
+
+    static std::string baseDirectory(const std::string& fileName)
+    {
+        size_t pos = fileName.find_last_of("/\\");
+        return (pos == std::string::npos ? std::string() : fileName.substr(0, pos));
+    }
+};
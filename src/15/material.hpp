@@ -3,6 +3,10 @@
 #include "math.hpp"
 #include "surface.hpp"
 #include "ray.hpp"
+#include "sampler.hpp"
+#include "hasher.hpp"
+
+class TextureCompiler;
 
 typedef enum {
     ScatterNone,      // no scattering, the path stops here
@@ -49,7 +53,7 @@ public:
         return vec3(0.0f);
     }
 
-    virtual ScatterRecord scatter(const Ray& /* ray */, const HitRecord& /* hr */, Prng& /* prng */) const
+    virtual ScatterRecord scatter(const Ray& /* ray */, const HitRecord& /* hr */, Sampler& /* sampler */) const
     {
         return ScatterRecord();
     }
@@ -58,4 +62,12 @@ public:
     {
         return ScatterRecord();
     }
+
+    // Replace the textures of the material by their compiled versions
+    virtual void compileTextures(TextureCompiler& /* compiler */)
+    {
+    }
+
+    // Add the parameters of the material and its textures to the hash
+    virtual void hash(Hasher& hasher) const = 0;
 };
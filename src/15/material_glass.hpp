@@ -14,7 +14,7 @@ public:
     {
     }
 
-    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Prng& prng) const override
+    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Sampler& sampler) const override
     {
         vec3 attenuation = vec3(1.0f);
         float n2 = refractiveIndex;
@@ -37,7 +37,7 @@ public:
             float cosIncident = dot(-ray.direction, hr.normal);
             float cosTransmitted = -dot(refracted, hr.normal);
             float fresnel = fresnelUnpolarized(cosIncident, cosTransmitted, n1, n2);
-            doReflection = prng.in01() < fresnel;
+            doReflection = sampler.in01() < fresnel;
         }
 
         if (doReflection) {
@@ -47,4 +47,10 @@ public:
             return ScatterRecord(normalize(refracted), attenuation);
         }
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(absorption);
+        hasher.add(refractiveIndex);
+    }
 };
@@ -4,6 +4,7 @@
 #include "math.hpp"
 #include "sampler.hpp"
 #include "texture.hpp"
+#include "texture_compiler.hpp"
 #include "tangentspace.hpp"
 
 class MaterialLambertian : public Material
@@ -15,19 +16,25 @@ public:
     {
     }
 
+    virtual void compileTextures(TextureCompiler& compiler) override
+    {
+        albedo = compiler.compile(albedo);
+    }
+
     vec3 brdf(const HitRecord& hr, float time) const
     {
-        vec3 a = albedo->value(hr.texcoord, time);
+        vec3 a = albedo->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, time);
         return a / pi;
     }
 
-    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Prng& prng) const override
+    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Sampler& sampler) const override
     {
         if (hr.backside)
             return ScatterRecord();
 
         TangentSpace ts(hr.normal);
-        vec3 newDirectionTS = Sampler::cosineWeightedOnHemisphere(prng.in01(), prng.in01());
+        vec2 u = sampler.in01x2();
+        vec3 newDirectionTS = Sampler::cosineWeightedOnHemisphere(u.x(), u.y());
         vec3 newDirection = ts.toWorldSpace(newDirectionTS);
         float cosTheta = dot(hr.normal, newDirection);
         if (cosTheta <= 0.0f)
@@ -47,4 +54,9 @@ public:
         vec3 attenuation = brdf(hr, ray.time) * cosTheta;
         return ScatterRecord(direction, p, attenuation);
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(albedo);
+    }
 };
@@ -15,4 +15,9 @@ public:
     {
         return hr.backside ? vec3(0.0f) : radiance;
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(radiance);
+    }
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "material.hpp"
+#include "texture_compiler.hpp"
 
 class MaterialMirror : public Material
 {
@@ -11,12 +12,22 @@ public:
     {
     }
 
-    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Prng&) const override
+    virtual void compileTextures(TextureCompiler& compiler) override
+    {
+        color = compiler.compile(color);
+    }
+
+    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Sampler&) const override
     {
         if (hr.backside)
             return ScatterRecord();
         vec3 newDirection = normalize(reflect(ray.direction, hr.normal));
-        vec3 attenuation = color->value(hr.texcoord, ray.time);
+        vec3 attenuation = color->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time);
         return ScatterRecord(newDirection, attenuation);
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(color);
+    }
 };
@@ -4,6 +4,7 @@
 #include "math.hpp"
 #include "sampler.hpp"
 #include "texture.hpp"
+#include "texture_compiler.hpp"
 #include "tangentspace.hpp"
 
 class MaterialPhong : public Material
@@ -21,6 +22,15 @@ public:
     {
     }
 
+    virtual void compileTextures(TextureCompiler& compiler) override
+    {
+        k_d = compiler.compile(k_d);
+        k_s = compiler.compile(k_s);
+        s = compiler.compile(s);
+        opacity = compiler.compile(opacity);
+        normal = compiler.compile(normal);
+    }
+
     vec3 brdf(const vec3& n, const vec3& l, const vec3& v,
             const vec3& kd, const vec3& ks, float shininess) const
     {
@@ -34,7 +44,7 @@ public:
     {
         vec3 n = hr.normal;
         if (normal) {
-            n = normal->value(hr.texcoord, t);
+            n = normal->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, t);
             n = 2.0f * n - vec3(1.0f);
             if (dot(n, n) > std::numeric_limits<float>::epsilon()
                     && dot(hr.tangent, hr.tangent) > std::numeric_limits<float>::epsilon()) {
@@ -45,11 +55,11 @@ public:
         return n;
     }
 
-    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Prng& prng) const override
+    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Sampler& sampler) const override
     {
         if (opacity) {
-            float alpha = opacity->value(hr.texcoord, ray.time).x();
-            bool transparent = (alpha < prng.in01());
+            float alpha = opacity->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time).x();
+            bool transparent = (alpha < sampler.in01());
             if (transparent) {
                 return ScatterRecord(ray.direction, vec3(1.0f));
             }
@@ -58,9 +68,9 @@ public:
         if (hr.backside)
             return ScatterRecord();
 
-        vec3 kd = k_d->value(hr.texcoord, ray.time);
-        vec3 ks = k_s->value(hr.texcoord, ray.time);
-        float shininess = s->value(hr.texcoord, ray.time).x();
+        vec3 kd = k_d->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time);
+        vec3 ks = k_s->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time);
+        float shininess = s->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time).x();
 
         vec3 n = getNormal(hr, ray.time);
         vec3 v = -ray.direction;
@@ -76,15 +86,17 @@ public:
             specularProbability = 0.9f;
 
         vec3 l; // this is the new direction
-        if (prng.in01() < specularProbability) {
+        float lobe = sampler.in01();
+        vec2 u = sampler.in01x2();
+        if (lobe < specularProbability) {
             // act specular
-            vec3 newDirectionAroundR = Sampler::phongWeightedOnHemisphere(shininess, prng.in01(), prng.in01());
+            vec3 newDirectionAroundR = Sampler::phongWeightedOnHemisphere(shininess, u.x(), u.y());
             TangentSpace rts = TangentSpace(r);
             l = normalize(rts.toWorldSpace(newDirectionAroundR));
         } else {
             // act diffuse
             TangentSpace ts(n);
-            vec3 newDirectionTS = Sampler::cosineWeightedOnHemisphere(prng.in01(), prng.in01());
+            vec3 newDirectionTS = Sampler::cosineWeightedOnHemisphere(u.x(), u.y());
             l = normalize(ts.toWorldSpace(newDirectionTS));
         }
 
@@ -109,10 +121,19 @@ public:
             return ScatterRecord();
 
         float p = cosTheta / pi;
-        vec3 kd = k_d->value(hr.texcoord, ray.time);
-        vec3 ks = k_s->value(hr.texcoord, ray.time);
-        float shininess = s->value(hr.texcoord, ray.time).x();
+        vec3 kd = k_d->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time);
+        vec3 ks = k_s->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time);
+        float shininess = s->filteredLookup(hr.texcoord, hr.dtdx, hr.dtdy, ray.time).x();
         vec3 attenuation = brdf(n, direction, -ray.direction, kd, ks, shininess) * cosTheta;
         return ScatterRecord(direction, p, attenuation);
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(k_d);
+        hasher.addObject(k_s);
+        hasher.addObject(s);
+        hasher.addObject(opacity);
+        hasher.addObject(normal);
+    }
 };
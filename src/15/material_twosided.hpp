@@ -28,11 +28,17 @@ public:
             return front->Le(hr, out);
     }
 
-    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Prng& prng) const override
+    virtual ScatterRecord scatter(const Ray& ray, const HitRecord& hr, Sampler& sampler) const override
     {
         if (hr.backside)
-            return back->scatter(ray, toFront(hr), prng);
+            return back->scatter(ray, toFront(hr), sampler);
         else
-            return front->scatter(ray, hr, prng);
+            return front->scatter(ray, hr, sampler);
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(front);
+        hasher.addObject(back);
     }
 };
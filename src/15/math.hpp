@@ -63,6 +63,8 @@ public:
     vec& operator*=(const vec& v) { for (int i = 0; i < N; i++) values[i] *= v[i]; return *this; }
     vec& operator/=(const vec& v) { for (int i = 0; i < N; i++) values[i] /= v[i]; return *this; }
 
+    bool operator==(const vec& v) const { for (int i = 0; i < N; i++) if (values[i] != v[i]) return false; return true; }
+
 };
 
 template<int N> vec<N> operator*(float s, const vec<N>& v) { return v * s; }
@@ -1,17 +1,22 @@
 #pragma once
 
+#include <utility>
+#include <memory>
+#include <span>
+
 #include "animation.hpp"
 #include "math.hpp"
 #include "material.hpp"
+#include "hasher.hpp"
 
 class Mesh;
 
 /* Compute tangents from positions, normals, and texcoords. */
 inline std::vector<vec3> computeTangents(
-        const std::vector<vec3>& positions,
-        const std::vector<vec3>& normals,
-        const std::vector<vec2>& texcoords,
-        const std::vector<unsigned int> indices)
+        std::span<const vec3> positions,
+        std::span<const vec3> normals,
+        std::span<const vec2> texcoords,
+        std::span<const unsigned int> indices)
 {
     size_t vertexCount = positions.size();
     size_t triangleCount = indices.size() / 3;
@@ -61,31 +66,83 @@ Surface* createSurfaceTriangle(const Mesh& mesh, const unsigned int* indices);
 class Mesh
 {
 public:
-    std::vector<vec3> positions;
-    std::vector<vec3> normals;          // may be empty
-    std::vector<vec2> texcoords;        // may be empty
-    std::vector<vec3> tangents;         // may be empty
-    std::vector<unsigned int> indices;
+    // The arrays are views, either of the vectors owned by the mesh below
+    // or of memory owned by someone else, e.g. a mapped SceneCache file.
+    std::span<const vec3> positions;
+    std::span<const vec3> normals;          // may be empty
+    std::span<const vec2> texcoords;        // may be empty
+    std::span<const vec3> tangents;         // may be empty
+    std::span<const unsigned int> indices;
     const Material* material;
     const Animation* animation;
 
-    // Create a new mesh.
-    Mesh(const std::vector<vec3>& pos,
-            const std::vector<vec3>& nrm,
-            const std::vector<vec2>& tc,
-            const std::vector<unsigned int>& ind,
+    // Storage for the arrays if the mesh owns them
+    std::vector<vec3> positionData;
+    std::vector<vec3> normalData;
+    std::vector<vec2> texcoordData;
+    std::vector<vec3> tangentData;
+    std::vector<unsigned int> indexData;
+    // Keeps the viewed memory alive if the mesh does not own the arrays
+    std::shared_ptr<const void> viewedMemory;
+
+    // Create a new mesh. Pass the vectors with std::move() to avoid copies.
+    Mesh(std::vector<vec3> pos,
+            std::vector<vec3> nrm,
+            std::vector<vec2> tc,
+            std::vector<unsigned int> ind,
+            const Material* mat,
+            const Animation* anim = nullptr) :
+        material(mat),
+        animation(anim),
+        positionData(std::move(pos)),
+        normalData(std::move(nrm)),
+        texcoordData(std::move(tc)),
+        indexData(std::move(ind))
+    {
+        if (normalData.size() > 0 && texcoordData.size() > 0) {
+            tangentData = computeTangents(positionData, normalData, texcoordData, indexData);
+        }
+        positions = positionData;
+        normals = normalData;
+        texcoords = texcoordData;
+        tangents = tangentData;
+        indices = indexData;
+    }
+
+    // Create a new mesh that views arrays in memory that is kept alive by
+    // the given pointer. The tangents must already be computed.
+    Mesh(std::span<const vec3> pos,
+            std::span<const vec3> nrm,
+            std::span<const vec2> tc,
+            std::span<const vec3> tng,
+            std::span<const unsigned int> ind,
+            std::shared_ptr<const void> memory,
             const Material* mat,
             const Animation* anim = nullptr) :
         positions(pos),
         normals(nrm),
         texcoords(tc),
+        tangents(tng),
         indices(ind),
         material(mat),
-        animation(anim)
+        animation(anim),
+        viewedMemory(std::move(memory))
     {
-        if (normals.size() > 0 && texcoords.size() > 0) {
-            tangents = computeTangents(positions, normals, texcoords, indices);
-        }
+    }
+
+    // The views must not be copied away from their storage
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    void hash(Hasher& hasher) const
+    {
+        hasher.addArray(positions.data(), positions.size());
+        hasher.addArray(normals.data(), normals.size());
+        hasher.addArray(texcoords.data(), texcoords.size());
+        hasher.addArray(tangents.data(), tangents.size());
+        hasher.addArray(indices.data(), indices.size());
+        hasher.addObject(material);
+        hasher.addObject(animation);
     }
 
     // return the number of surfaces (triangles)
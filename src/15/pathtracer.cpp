@@ -1,5 +1,19 @@
 #include <vector>
+#include <memory>
 #include <limits>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <sstream>
+
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "math.hpp"
 #include "ray.hpp"
@@ -8,6 +22,8 @@
 #include "camera.hpp"
 #include "prng.hpp"
 #include "sampler.hpp"
+#include "sampler_random.hpp"
+#include "sampler_sobol.hpp"
 #include "surface_sphere.hpp"
 #include "surface_triangle.hpp"
 #include "material_twosided.hpp"
@@ -29,9 +45,13 @@
 #include "color.hpp"
 #include "bvh.hpp"
 #include "imgsave.hpp"
+#include "framebuffer.hpp"
+#include "checkpoint.hpp"
+#include "tiles.hpp"
 #include "envmap.hpp"
 #include "envmap_cube.hpp"
 #include "envmap_equirect.hpp"
+#include "envmap_prepared.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -47,7 +67,7 @@ float powerHeuristicMIS(float f, float g)
 }
 
 // Compute the radiance for one path sample
-vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
+vec3 pathSample(const Scene& scene, const Ray& startRay, Sampler& sampler)
 {
     const float MinHitDistance = 0.0001f;
     const float MaxHitDistance = std::numeric_limits<float>::max();
@@ -57,14 +77,20 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
     vec3 throughput(1.0f);
     Ray ray = startRay;
     for (int segment = 0; segment < MaxPathSegments; segment++) {
+        // bounce 0 is used by the camera
+        sampler.startBounce(segment + 1);
         HitRecord hr = scene.bvh.hit(ray, MinHitDistance, MaxHitDistance);
         if (!hr.haveHit) {
-            if (scene.envMap)
-                radiance += throughput * scene.envMap->value(ray.direction, ray.time);
+            if (scene.envMap) {
+                float footprint = 0.0f;
+                if (ray.hasDifferentials)
+                    footprint = std::max(length(ray.dxDirection - ray.direction), length(ray.dyDirection - ray.direction));
+                radiance += throughput * scene.envMap->filteredValue(ray.direction, footprint, ray.time);
+            }
             break;
         }
         // scatter the ray at the hit point
-        ScatterRecord sr = hr.material->scatter(ray, hr, prng);
+        ScatterRecord sr = hr.material->scatter(ray, hr, sampler);
         // add radiance emitted at this intersection
         radiance += throughput * hr.material->Le(hr, -ray.direction);
         if (sr.type == ScatterNone)
@@ -81,9 +107,9 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
             lightsP /= scene.lights.size();
             nextThroughput *= powerHeuristicMIS(sr.p, lightsP);
             // choose a light source randomly
-            size_t lightIndex = prng.in01() * scene.lights.size();
+            size_t lightIndex = sampler.in01() * scene.lights.size();
             // get direction to it
-            vec3 lightDir = scene.lights[lightIndex]->direction(hr.position, ray.time, prng);
+            vec3 lightDir = scene.lights[lightIndex]->direction(hr.position, ray.time, sampler);
             // get the pdf value for this direction
             float lightDirP = 0.0f;
             for (size_t i = 0; i < scene.lights.size(); i++)
@@ -119,7 +145,7 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
             float q = 1.0f - maxThroughput; // probability to cancel the path
             if (q > 0.95f)
                 q = 0.95f;
-            if (prng.in01() < q)
+            if (sampler.in01() < q)
                 break; // cancel
             float rrWeight = 1.0f / (1.0f - q);
             throughput *= rrWeight;
@@ -129,17 +155,457 @@ vec3 pathSample(const Scene& scene, const Ray& startRay, Prng& prng)
     return radiance;
 }
 
-// Path Tracing main loops
-int main(void)
+// Compute a hash that identifies the scene as seen by the camera, from the
+// inputs of the rendering: the surfaces with their geometry, materials,
+// textures and animations, the environment map, and the camera.
+uint64_t sceneHash(const Scene& scene, const Camera& camera)
 {
+    Hasher hasher;
+    hasher.add(scene.surfaces.size());
+    for (size_t i = 0; i < scene.surfaces.size(); i++)
+        scene.surfaces[i]->hash(hasher);
+    hasher.add(scene.lights.size());
+    hasher.addObject(scene.envMap.get());
+    camera.hash(hasher);
+    return hasher.h;
+}
+
+// Save the image as <name>.pfm and <name>.ppm, and optionally the variance
+// and sample count images as <name>-variance.pfm and <name>-samples.pfm.
+// If a background image is given, pixels without samples are taken from it.
+// The files are written with a temporary name first and then renamed, so that
+// snapshots are never seen incomplete.
+void saveImages(const Framebuffer& fb, const std::string& name, bool writeVariance,
+        const std::vector<vec3>& background = {})
+{
+    auto save = [&](const std::string& fileName, const std::vector<vec3>& img) {
+        std::string tmpName = fileName + ".tmp";
+        if (fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".ppm") == 0)
+            saveImageAsPPM(tmpName, to8Bit(img), fb.width, fb.height);
+        else
+            saveImageAsPfm(tmpName, img, fb.width, fb.height);
+        std::rename(tmpName.c_str(), fileName.c_str());
+    };
+    std::vector<vec3> img = fb.image();
+    for (size_t i = 0; i < background.size(); i++)
+        if (fb.samples[i] == 0)
+            img[i] = background[i];
+    save(name + ".pfm", img);
+    save(name + ".ppm", img);
+    if (writeVariance) {
+        save(name + "-variance.pfm", fb.varianceImage());
+        save(name + "-samples.pfm", fb.samplesImage());
+    }
+}
+
+// Set when SIGINT or SIGTERM is received. The handler stays installed, so
+// that further signals cannot interrupt writing the output files. It is
+// installed without SA_RESTART: blocking calls such as reading the next job
+// in the render server fail with EINTR, and the stop is noticed at once.
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int /* sig */)
+{
+    stopRequested = 1;
+}
+
+void installStopHandler()
+{
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = requestStop;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+}
+
+// Parameters of a rendering
+class RenderSettings
+{
+public:
     // The image: RGB values per pixel, floating point
     int width = 800;
     int height = 600;
-    std::vector<vec3> img(width * height);
-    int sqrtSpp = 20;
+    unsigned int spp = 400;
+    SamplerType sampler = SamplerTypeSobol;
+    bool blueNoise = false; // with the Sobol sampler: distribute the error as blue noise; useful for previews with few spp
+    bool adaptive = false; // adaptive sampling: spp is then the average number of samples per pixel
+    unsigned int adaptiveMinSpp = 16;
+    unsigned int maxSpp = 4096;
+    float targetError = 0.01f; // relative error at which a pixel is done
+    unsigned int passSpp = 0; // progressive rendering: samples per pixel per pass; 0 means no limit
+    double timeBudget = 0.0; // render until this many seconds are used instead of until spp is reached
+    double snapshotInterval = 0.0; // write the current image every this many seconds
+    double checkpointInterval = 0.0; // write the checkpoint every this many seconds, and when stopped
+    bool resume = false; // continue from the checkpoint if it matches the scene and parameters
+    std::string checkpointFileName = "checkpoint.bin";
+    std::string outputName = "image"; // write <outputName>.pfm and <outputName>.ppm
+    bool writeVariance = false; // write <outputName>-variance.pfm and <outputName>-samples.pfm
+    int tileSize = 16; // edge length of the tiles that threads render
+    TileOrder tileOrder = TileOrderHilbert;
+    bool reportThreads = false; // print per thread statistics of the tile scheduler
+    // Region of interest: only the pixels in the crop window are rendered, and
+    // of those only the ones with a nonzero value in the mask image, if given.
+    // A crop width or height of 0 means the complete image.
+    int cropX = 0;
+    int cropY = 0;
+    int cropWidth = 0;
+    int cropHeight = 0;
+    std::string maskFileName; // PFM image of the same size as the rendered image
+    std::string compositeFileName; // if given, write the complete image with the rendered
+                                   // pixels composited into this PFM image instead of the crop window
+    // The camera
+    vec3 cameraPosition = vec3(0.0f, 10.0f, 10.0f);
+    vec3 cameraTarget = vec3(0.0f, 0.4f, 0.0f);
+    float cameraFovy = 50.0f; // vertical field of view, in degrees
+    float focusDistance = 17.0f;
+    float apertureDiameter = 0.8f;
+};
 
-    // The scene and camera
-    Scene scene;
+// The rendering of one view: its settings and camera, its framebuffer, and
+// the state of its pass loop. Views are rendered in passes (see renderViews());
+// each view plans the samples of its pixels for the next pass.
+class View
+{
+public:
+    RenderSettings rs;
+    AnimationConstant cameraAnimation;
+    Camera camera;
+    Framebuffer fb;
+    std::vector<unsigned int> passSamples;  // samples per pixel in the next pass
+    size_t passSampleCount;                 // sum of passSamples
+    size_t budget;                          // remaining sample budget
+    unsigned int sppLimit;                  // maximum samples per pixel
+    int pass;                               // the next pass
+    int firstPass;                          // the first pass after resuming
+    double previousElapsed;                 // rendering time before resuming
+    bool done;
+    std::vector<unsigned char> selected;    // per pixel: whether it is rendered
+    size_t selectedCount;                   // number of rendered pixels
+    std::vector<vec3> background;           // the image to composite into, if any
+    Checkpoint checkpoint;
+    std::chrono::steady_clock::time_point lastSnapshotTime;
+    std::chrono::steady_clock::time_point lastCheckpointTime;
+
+    View(const RenderSettings& settings) :
+        rs(settings),
+        cameraAnimation(Transformation(rs.cameraPosition, rs.cameraTarget)),
+        camera(radians(rs.cameraFovy), float(rs.width) / rs.height,
+                rs.focusDistance, rs.apertureDiameter, &cameraAnimation),
+        fb(rs.width, rs.height),
+        passSamples(rs.width * rs.height),
+        passSampleCount(0),
+        budget(rs.timeBudget > 0.0 ? std::numeric_limits<size_t>::max() : size_t(rs.spp) * rs.width * rs.height),
+        sppLimit(rs.timeBudget > 0.0 ? rs.maxSpp : std::min(rs.spp, rs.maxSpp)),
+        pass(0), firstPass(0), previousElapsed(0.0), done(false),
+        selected(rs.width * rs.height, 1), selectedCount(rs.width * rs.height),
+        lastSnapshotTime(std::chrono::steady_clock::now()),
+        lastCheckpointTime(lastSnapshotTime)
+    {
+    }
+
+    // Determine the pixels to render from the crop window and the mask, and
+    // load the background image. Returns false if they do not fit the image.
+    bool initRegion(FILE* log)
+    {
+        if (rs.cropWidth <= 0 || rs.cropHeight <= 0) {
+            rs.cropX = rs.cropY = 0;
+            rs.cropWidth = rs.width;
+            rs.cropHeight = rs.height;
+        }
+        if (rs.cropX < 0 || rs.cropY < 0 || rs.cropX + rs.cropWidth > rs.width || rs.cropY + rs.cropHeight > rs.height) {
+            fprintf(log, "Crop window %d,%d,%d,%d is not inside the image\n", rs.cropX, rs.cropY, rs.cropWidth, rs.cropHeight);
+            return false;
+        }
+        std::vector<vec3> mask;
+        if (!rs.maskFileName.empty()) {
+            int w, h;
+            if (!loadImageFromPfm(rs.maskFileName, mask, w, h) || w != rs.width || h != rs.height) {
+                fprintf(log, "%s: cannot load mask of size %dx%d\n", rs.maskFileName.c_str(), rs.width, rs.height);
+                return false;
+            }
+        }
+        selectedCount = 0;
+        for (int y = 0; y < rs.height; y++) {
+            for (int x = 0; x < rs.width; x++) {
+                int i = y * rs.width + x;
+                selected[i] = (x >= rs.cropX && x < rs.cropX + rs.cropWidth
+                        && y >= rs.cropY && y < rs.cropY + rs.cropHeight
+                        && (mask.empty() || mask[i].x() > 0.0f || mask[i].y() > 0.0f || mask[i].z() > 0.0f));
+                selectedCount += selected[i];
+            }
+        }
+        if (!rs.compositeFileName.empty()) {
+            int w, h;
+            if (!loadImageFromPfm(rs.compositeFileName, background, w, h) || w != rs.width || h != rs.height) {
+                fprintf(log, "%s: cannot load image of size %dx%d\n", rs.compositeFileName.c_str(), rs.width, rs.height);
+                return false;
+            }
+        }
+        if (rs.timeBudget <= 0.0)
+            budget = size_t(rs.spp) * selectedCount;
+        return true;
+    }
+
+    // Checkpoints store everything the pass loop depends on, so with the
+    // deterministic sampler a resumed rendering gives the same image as an
+    // uninterrupted one (except with a time budget, which depends on timing).
+    void initCheckpoint(const Scene& scene, FILE* log)
+    {
+        if (rs.checkpointInterval <= 0.0 && !rs.resume)
+            return;
+        checkpoint.sceneHash = sceneHash(scene, camera);
+        Hasher parameterHasher;
+        parameterHasher.add(rs.width);
+        parameterHasher.add(rs.height);
+        parameterHasher.add(rs.spp);
+        parameterHasher.add(int(rs.sampler));
+        parameterHasher.add(rs.blueNoise);
+        parameterHasher.add(rs.adaptive);
+        parameterHasher.add(rs.adaptiveMinSpp);
+        parameterHasher.add(rs.maxSpp);
+        parameterHasher.add(rs.targetError);
+        parameterHasher.add(rs.passSpp);
+        parameterHasher.add(rs.timeBudget);
+        parameterHasher.addBytes(selected.data(), selected.size());
+        checkpoint.parameterHash = parameterHasher.h;
+        if (rs.resume) {
+            if (checkpoint.load(rs.checkpointFileName, fb)) {
+                pass = firstPass = checkpoint.pass;
+                budget = checkpoint.budget;
+                previousElapsed = checkpoint.elapsed;
+                fprintf(log, "Resuming from %s at pass %d\n", rs.checkpointFileName.c_str(), firstPass);
+            } else {
+                fprintf(log, "No matching %s found, starting from scratch\n", rs.checkpointFileName.c_str());
+            }
+        }
+    }
+
+    void saveCheckpoint(double elapsed, FILE* log)
+    {
+        checkpoint.pass = pass;
+        checkpoint.budget = budget;
+        checkpoint.elapsed = elapsed;
+        if (!checkpoint.save(rs.checkpointFileName, fb))
+            fprintf(log, "Cannot write %s\n", rs.checkpointFileName.c_str());
+        lastCheckpointTime = std::chrono::steady_clock::now();
+    }
+
+    // Save the image: the crop window, or the complete image with the rendered
+    // pixels composited into the background
+    void save() const
+    {
+        if (!background.empty())
+            saveImages(fb, rs.outputName, rs.writeVariance, background);
+        else if (rs.cropWidth < rs.width || rs.cropHeight < rs.height)
+            saveImages(fb.crop(rs.cropX, rs.cropY, rs.cropWidth, rs.cropHeight), rs.outputName, rs.writeVariance);
+        else
+            saveImages(fb, rs.outputName, rs.writeVariance);
+    }
+
+    // Determine the number of samples for each pixel in the next pass;
+    // pixels that are not selected get none
+    void planPass()
+    {
+        int n = rs.width * rs.height;
+        size_t passBudget = std::min(budget, rs.passSpp > 0 ? size_t(rs.passSpp) * selectedCount : budget);
+        if (rs.adaptive && pass > 0) {
+            // Estimate how many more samples each pixel needs to reach the target error,
+            // knowing that the error decreases with the square root of the sample count.
+            // Each pass at most doubles the samples of a pixel so that the estimates
+            // can improve before the budget is spent.
+            std::vector<double> need(n);
+            double totalNeed = 0.0;
+            for (int i = 0; i < n; i++) {
+                unsigned int s = fb.samples[i];
+                double ratio = std::min(double(fb.relativeError(i)) / rs.targetError, 1e3);
+                need[i] = 0.0;
+                if (selected[i] && ratio > 1.0 && s < rs.maxSpp)
+                    need[i] = std::min(s * (ratio * ratio - 1.0), double(std::min(s, rs.maxSpp - s)));
+                totalNeed += need[i];
+            }
+            double scale = std::min(1.0, passBudget / std::max(totalNeed, 1.0));
+            for (int i = 0; i < n; i++)
+                passSamples[i] = need[i] * scale;
+        } else {
+            bool targetReached = (pass > 0);
+            for (int i = 0; i < n && targetReached; i++)
+                if (selected[i] && fb.relativeError(i) > rs.targetError)
+                    targetReached = false;
+            unsigned int s = (rs.adaptive ? rs.adaptiveMinSpp : rs.passSpp > 0 ? rs.passSpp : rs.spp);
+            for (int i = 0; i < n; i++)
+                passSamples[i] = (targetReached || !selected[i] ? 0 : std::min(s, sppLimit - std::min(sppLimit, fb.samples[i])));
+        }
+        passSampleCount = 0;
+        for (int i = 0; i < n; i++)
+            passSampleCount += passSamples[i];
+    }
+};
+
+// Render the planned samples of a pass for all views. The tiles of all views
+// are distributed to the threads together, so that all threads stay busy
+// until the last view is done; each thread accumulates into a copy of its tile.
+void renderPass(const Scene& scene, const std::vector<std::unique_ptr<View>>& views, TileScheduler& scheduler)
+{
+    scheduler.startPass();
+    #pragma omp parallel
+    {
+        Tile tile;
+        while (scheduler.next(tile)) {
+            View& view = *views[tile.view];
+            if (view.passSampleCount == 0)
+                continue;
+            auto tileStart = std::chrono::steady_clock::now();
+            // Sampler per tile (so that it works with parallel threads)
+            SamplerSobol samplerSobol(42, view.rs.blueNoise);
+            SamplerRandom samplerRandom(42, view.fb.width);
+            Sampler& sampler = (view.rs.sampler == SamplerTypeRandom
+                    ? static_cast<Sampler&>(samplerRandom) : samplerSobol);
+            Framebuffer tileFb = view.fb.crop(tile.x, tile.y, tile.width, tile.height);
+            for (int ty = 0; ty < tile.height; ty++) {
+                for (int tx = 0; tx < tile.width; tx++) {
+                    int x = tile.x + tx;
+                    int y = tile.y + ty;
+                    int pixel = y * view.fb.width + x;
+                    int tilePixel = ty * tile.width + tx;
+                    // Add samples; the first dimension of each sample is the position in the pixel.
+                    // The sample indices continue where the previous pass stopped.
+                    unsigned int firstSample = tileFb.samples[tilePixel];
+                    for (unsigned int i = firstSample; i < firstSample + view.passSamples[pixel]; i++) {
+                        sampler.startSample(x, y, i);
+                        sampler.startBounce(0);
+                        vec2 pixelSample = sampler.in01x2();
+                        float p = (x + pixelSample.x()) / view.fb.width;
+                        float q = (y + pixelSample.y()) / view.fb.height;
+                        Ray ray = view.camera.getRay(p, q, 0.0f, 0.0f, sampler,
+                                1.0f / view.fb.width, 1.0f / view.fb.height);
+                        tileFb.add(tilePixel, pathSample(scene, ray, sampler));
+                    }
+                }
+            }
+            view.fb.paste(tileFb, tile.x, tile.y);
+            scheduler.addStats(std::chrono::duration<double>(std::chrono::steady_clock::now() - tileStart).count());
+        }
+    }
+    scheduler.finishPass();
+}
+
+// Render the views and save their images. All views share the scene, BVH, and
+// threads; the tile size and order are taken from the first view.
+// Rendering happens in passes. Without adaptive sampling, each pass adds passSpp
+// samples to each pixel (or spp if passSpp is 0). In adaptive mode, the first
+// pass renders adaptiveMinSpp samples per pixel and further passes spend the
+// remaining budget on the pixels whose relative error is still above
+// targetError. The budget is spp samples per selected pixel, or, if a time
+// budget is given, the number of samples that fits into that time. A view stops
+// early when no pixel is above targetError anymore, and all views stop when
+// SIGINT or SIGTERM is received, after the current pass.
+// Only the tiles of the crop windows that contain selected pixels are
+// scheduled, so rendering a small region takes time proportional to its size.
+// Progress messages are written to log. Returns false if a crop window, mask,
+// or background image is invalid.
+bool renderViews(const Scene& scene, const std::vector<RenderSettings>& settings, FILE* log)
+{
+    std::vector<std::unique_ptr<View>> views;
+    TileScheduler scheduler(settings[0].tileSize, settings[0].tileOrder);
+    int pass = std::numeric_limits<int>::max();
+    for (size_t v = 0; v < settings.size(); v++) {
+        views.push_back(std::make_unique<View>(settings[v]));
+        View& view = *views[v];
+        if (!view.initRegion(log))
+            return false;
+        view.initCheckpoint(scene, log);
+        scheduler.addRegion(view.rs.width, view.rs.cropX, view.rs.cropY,
+                view.rs.cropWidth, view.rs.cropHeight, v, view.selected);
+        pass = std::min(pass, views[v]->firstPass);
+    }
+    // prefix for the messages about a view
+    auto name = [&](const View& view) {
+        return views.size() > 1 ? view.rs.outputName + ": " : std::string();
+    };
+    auto startTime = std::chrono::steady_clock::now();
+    double lastPassDuration = 0.0;
+    for (;; pass++) {
+        // Plan the pass, and check which views are done
+        size_t passSampleCount = 0;
+        for (auto& viewPtr : views) {
+            View& view = *viewPtr;
+            if (view.done)
+                continue;
+            view.planPass();
+            double elapsed = view.previousElapsed
+                + std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            if (view.passSampleCount == 0) {
+                fprintf(log, "%sSample budget used or target error reached\n", name(view).c_str());
+                view.done = true;
+            } else if (view.rs.timeBudget > 0.0 && view.pass > view.firstPass
+                    && elapsed + lastPassDuration > view.rs.timeBudget) {
+                fprintf(log, "%sTime budget used\n", name(view).c_str());
+                view.done = true;
+            } else if (stopRequested) {
+                fprintf(log, "%sStop requested\n", name(view).c_str());
+                if (view.rs.checkpointInterval > 0.0)
+                    view.saveCheckpoint(elapsed, log);
+                view.done = true;
+            }
+            if (view.done)
+                view.passSampleCount = 0;
+            passSampleCount += view.passSampleCount;
+        }
+        if (passSampleCount == 0)
+            break;
+        // Render the pass
+        fprintf(log, "Pass %d: %zu samples... ", pass, passSampleCount);
+        auto passStartTime = std::chrono::steady_clock::now();
+        renderPass(scene, views, scheduler);
+        lastPassDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - passStartTime).count();
+        fprintf(log, "done after %.1fs\n", lastPassDuration);
+        for (auto& viewPtr : views) {
+            View& view = *viewPtr;
+            if (view.passSampleCount == 0)
+                continue;
+            view.budget -= std::min(view.budget, view.passSampleCount);
+            view.pass++;
+            auto now = std::chrono::steady_clock::now();
+            // Write a snapshot if it is time for that
+            if (view.rs.snapshotInterval > 0.0
+                    && std::chrono::duration<double>(now - view.lastSnapshotTime).count() >= view.rs.snapshotInterval) {
+                view.save();
+                view.lastSnapshotTime = std::chrono::steady_clock::now();
+            }
+            // Write a checkpoint if it is time for that
+            if (view.rs.checkpointInterval > 0.0
+                    && std::chrono::duration<double>(now - view.lastCheckpointTime).count() >= view.rs.checkpointInterval) {
+                view.saveCheckpoint(view.previousElapsed + std::chrono::duration<double>(now - startTime).count(), log);
+            }
+        }
+    }
+    for (auto& viewPtr : views) {
+        View& view = *viewPtr;
+        size_t totalSamples = 0;
+        for (int i = 0; i < view.rs.width * view.rs.height; i++)
+            totalSamples += view.fb.samples[i];
+        fprintf(log, "%sRendered %zu samples, on average %.1f per pixel, in %.1fs\n", name(view).c_str(),
+                totalSamples, double(totalSamples) / std::max(view.selectedCount, size_t(1)), view.previousElapsed
+                + std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+        // Save the image
+        view.save();
+    }
+    if (settings[0].reportThreads)
+        scheduler.report(log);
+    return true;
+}
+
+// Render one view and save its image, see renderViews()
+bool render(const Scene& scene, const RenderSettings& rs, FILE* log)
+{
+    return renderViews(scene, std::vector<RenderSettings>(1, rs), log);
+}
+
+// Build the scene
+void buildScene(Scene& scene)
+{
     Prng scenePrng(1234);
 
     // a basic quad
@@ -187,42 +653,240 @@ int main(void)
     // the environment map
     Texture* map = scene.take(new TextureConstant(vec3(1.0f)));
     scene.take(new EnvMapEquiRect(map));
-    // the camera
-    Transformation camTrans(vec3(0.0f, 10.0f, 10.0f), vec3(0.0f, 0.4f, 0.0f));
-    Animation* camAnim = scene.take(new AnimationConstant(camTrans));
-    float focusDistance = 17.0f;
-    float apertureDiameter = 0.8f;
-    Camera camera(radians(50.0f), float(width) / height, focusDistance, apertureDiameter, camAnim);
+}
 
-    // Loop over pixels in the image
-    scene.buildBVH(0.0f, 0.0f);
-    #pragma omp parallel for schedule(dynamic)
-    for (int pixel = 0; pixel < width * height; pixel++) {
-        // Radom number generator per pixel (so that it works with parallel threads)
-        Prng prng(pixel + 42);
-        // Get pixel x, y from linear index
-        int y = pixel / width;
-        int x = pixel % width;
-        // Initialize pixel
-        img[y * width + x] = vec3(0.0f);
-        // Add stratified samples
-        for (int i = 0; i < sqrtSpp; i++) {
-            for (int j = 0; j < sqrtSpp; j++) {
-                float sp = (i + prng.in01()) / sqrtSpp;
-                float sq = (j + prng.in01()) / sqrtSpp;
-                float p = (x + sp) / width;
-                float q = (y + sq) / height;
-                Ray ray = camera.getRay(p, q, 0.0f, 0.0f, prng);
-                img[y * width + x] += pathSample(scene, ray, prng);
-            }
+// Parse a render job of the form "render key=value ...". The settings are
+// changed for all given keys; returns false and sets error if the job is invalid.
+bool parseJob(const std::string& line, RenderSettings& rs, std::string& error)
+{
+    std::istringstream iss(line);
+    std::string word;
+    iss >> word;
+    if (word != "render") {
+        error = "unknown command " + word;
+        return false;
+    }
+    auto parseVec3 = [](const std::string& value, vec3& v) {
+        float x, y, z;
+        char dummy;
+        if (std::sscanf(value.c_str(), "%f,%f,%f%c", &x, &y, &z, &dummy) != 3)
+            return false;
+        v = vec3(x, y, z);
+        return true;
+    };
+    while (iss >> word) {
+        size_t eq = word.find('=');
+        std::string key = word.substr(0, eq);
+        std::string value = (eq == std::string::npos ? std::string() : word.substr(eq + 1));
+        bool ok = true;
+        if (key == "width")
+            ok = (std::sscanf(value.c_str(), "%d", &rs.width) == 1 && rs.width > 0);
+        else if (key == "height")
+            ok = (std::sscanf(value.c_str(), "%d", &rs.height) == 1 && rs.height > 0);
+        else if (key == "spp")
+            ok = (std::sscanf(value.c_str(), "%u", &rs.spp) == 1 && rs.spp > 0);
+        else if (key == "passSpp")
+            ok = (std::sscanf(value.c_str(), "%u", &rs.passSpp) == 1);
+        else if (key == "timeBudget")
+            ok = (std::sscanf(value.c_str(), "%lf", &rs.timeBudget) == 1);
+        else if (key == "snapshotInterval")
+            ok = (std::sscanf(value.c_str(), "%lf", &rs.snapshotInterval) == 1);
+        else if (key == "adaptive")
+            rs.adaptive = (value == "1");
+        else if (key == "blueNoise")
+            rs.blueNoise = (value == "1");
+        else if (key == "sampler") {
+            ok = (value == "sobol" || value == "random");
+            rs.sampler = (value == "random" ? SamplerTypeRandom : SamplerTypeSobol);
+        }
+        else if (key == "position")
+            ok = parseVec3(value, rs.cameraPosition);
+        else if (key == "target")
+            ok = parseVec3(value, rs.cameraTarget);
+        else if (key == "fovy")
+            ok = (std::sscanf(value.c_str(), "%f", &rs.cameraFovy) == 1);
+        else if (key == "focusDistance")
+            ok = (std::sscanf(value.c_str(), "%f", &rs.focusDistance) == 1);
+        else if (key == "aperture")
+            ok = (std::sscanf(value.c_str(), "%f", &rs.apertureDiameter) == 1);
+        else if (key == "crop") {
+            char dummy;
+            ok = (std::sscanf(value.c_str(), "%d,%d,%d,%d%c", &rs.cropX, &rs.cropY,
+                        &rs.cropWidth, &rs.cropHeight, &dummy) == 4);
+        } else if (key == "mask")
+            rs.maskFileName = value;
+        else if (key == "composite")
+            rs.compositeFileName = value;
+        else if (key == "output")
+            ok = !(rs.outputName = value).empty();
+        else
+            ok = false;
+        if (!ok) {
+            error = "invalid parameter " + word;
+            return false;
         }
-        // Normalize
-        img[y * width + x] /= sqrtSpp * sqrtSpp;
     }
+    return true;
+}
 
-    // Save the image
-    saveImageAsPfm("image.pfm", img, width, height);
-    saveImageAsPPM("image.ppm", to8Bit(img), width, height);
+// Render server: keep the scene loaded and render jobs received over a Unix
+// domain socket, one client at a time. A client sends one job per line, e.g.
+//   render width=400 height=300 spp=64 position=0,10,10 target=0,0.4,0 output=/tmp/view
+// (see parseJob() for all keys; missing keys keep their default values) and
+// gets the progress messages of the rendering, followed by a line
+// "done <output>.pfm" or "error <message>". The line "quit" stops the server,
+// as do SIGINT and SIGTERM.
+// To check a local fix, re-render only a region and composite it into the
+// previous result, e.g.
+//   render crop=96,64,48,32 composite=/tmp/view.pfm output=/tmp/view-fixed
+int renderServer(const Scene& scene, const RenderSettings& defaults, const std::string& socketPath)
+{
+    sockaddr_un sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(sa.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", socketPath.c_str());
+        return 1;
+    }
+    std::strcpy(sa.sun_path, socketPath.c_str());
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0
+            || listen(listenFd, 16) != 0) {
+        fprintf(stderr, "%s: %s\n", socketPath.c_str(), std::strerror(errno));
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN); // clients may disconnect while we write
+    fprintf(stderr, "Waiting for render jobs on %s\n", socketPath.c_str());
 
+    bool quit = false;
+    while (!quit && !stopRequested) {
+        pollfd p = { listenFd, POLLIN, 0 };
+        if (poll(&p, 1, 200) <= 0)
+            continue;
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        FILE* in = fdopen(fd, "r");
+        FILE* out = fdopen(dup(fd), "w");
+        setvbuf(out, nullptr, _IOLBF, 0);
+        char buf[4096];
+        while (!quit && !stopRequested && fgets(buf, sizeof(buf), in)) {
+            std::string line(buf);
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+                line.pop_back();
+            if (line.empty())
+                continue;
+            if (line == "quit") {
+                quit = true;
+                break;
+            }
+            RenderSettings rs = defaults;
+            std::string error;
+            if (!parseJob(line, rs, error)) {
+                fprintf(out, "error %s\n", error.c_str());
+                continue;
+            }
+            fprintf(stderr, "Job: %s\n", line.c_str());
+            if (render(scene, rs, out))
+                fprintf(out, "done %s.pfm\n", rs.outputName.c_str());
+            else
+                fprintf(out, "error invalid region\n");
+        }
+        fclose(out);
+        fclose(in);
+    }
+    close(listenFd);
+    unlink(socketPath.c_str());
     return 0;
 }
+
+// Path Tracing main loops
+// Usage: pathtracer [options]                   render the image
+//        pathtracer [options] --server <socket> keep the scene loaded and render jobs
+//                                               received on the Unix domain socket,
+//                                               see renderServer()
+// Options: --import <file.obj>     add the geometry of an OBJ file to the scene
+//          --texture-cache <MiB>   load imported textures on demand through a
+//                                  texture cache with this memory budget
+//          --scene-cache           keep imported scenes in a binary cache
+//          --bake <resolution>     bake procedural textures into images
+int main(int argc, char* argv[])
+{
+    RenderSettings rs;
+    Scene scene;
+    std::vector<std::string> importFileNames;
+    std::string serverSocket;
+    // Imported textures can be loaded on demand through a texture cache that
+    // keeps at most this many bytes of texels in memory; 0 loads them completely
+    size_t textureCacheBudget = 0;
+    // Imported scenes can be stored in a binary cache that later runs map
+    // into memory instead of parsing the files again
+    bool useSceneCache = false;
+    // The texture graphs are compiled once the scene is built; procedural
+    // textures are baked into images of this size, unless it is 0
+    int textureBakeResolution = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool haveValue = (i + 1 < argc);
+        if (arg == "--server" && haveValue) {
+            serverSocket = argv[++i];
+        } else if (arg == "--import" && haveValue) {
+            importFileNames.push_back(argv[++i]);
+        } else if (arg == "--texture-cache" && haveValue && std::atoi(argv[i + 1]) > 0) {
+            textureCacheBudget = size_t(std::atoi(argv[++i])) << 20;
+        } else if (arg == "--scene-cache") {
+            useSceneCache = true;
+        } else if (arg == "--bake" && haveValue && std::atoi(argv[i + 1]) > 0) {
+            textureBakeResolution = std::atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Invalid argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (textureCacheBudget > 0)
+        scene.textureCache = std::make_unique<TextureCache>("texture-cache", textureCacheBudget);
+    if (useSceneCache)
+        scene.sceneCache = std::make_unique<SceneCache>("scene-cache");
+    // The environment map is resampled into a cube map for fast lookups, at
+    // the resolution of its texels; maps without texels are kept. The map is
+    // sampled at t=0 only, so disable this for animated environment maps.
+    bool prepareEnvMap = true;
+    buildScene(scene);
+    for (size_t i = 0; i < importFileNames.size(); i++)
+        if (!importIntoScene(scene, importFileNames[i]))
+            return 1;
+    scene.compileTextures(textureBakeResolution);
+    if (prepareEnvMap && scene.envMap && scene.envMap->preparedFaceSize() > 0)
+        scene.take(new EnvMapPrepared(*scene.envMap, scene.envMap->preparedFaceSize()));
+    scene.buildBVH(0.0f, 0.0f);
+    installStopHandler();
+
+    if (!serverSocket.empty())
+        return renderServer(scene, rs, serverSocket);
+
+    // Render a stereo pair instead of a single image: two views that share
+    // the scene, BVH, and threads
+    bool stereo = false;
+    float eyeDistance = 0.3f;
+    std::vector<RenderSettings> views;
+    if (stereo) {
+        vec3 right = normalize(cross(rs.cameraTarget - rs.cameraPosition, vec3(0.0f, 1.0f, 0.0f)));
+        for (int eye = -1; eye <= 1; eye += 2) {
+            RenderSettings view = rs;
+            view.cameraPosition += eye * 0.5f * eyeDistance * right;
+            view.cameraTarget += eye * 0.5f * eyeDistance * right;
+            view.outputName = (eye < 0 ? "left" : "right");
+            view.checkpointFileName = view.outputName + "-checkpoint.bin";
+            views.push_back(view);
+        }
+    } else {
+        views.push_back(rs);
+    }
+    bool ok = renderViews(scene, views, stderr);
+    if (scene.textureCache)
+        scene.textureCache->report(stderr);
+    if (scene.sceneCache)
+        scene.sceneCache->report(stderr);
+    return ok ? 0 : 1;
+}
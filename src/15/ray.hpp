@@ -9,12 +9,19 @@ public:
     vec3 direction; // must have unit length!
     vec3 invDirection;
     float time;
+    // Ray differentials: the rays through the neighboring pixels in x and y
+    // direction, to estimate the footprint of a pixel on a surface.
+    // Only camera rays have them.
+    bool hasDifferentials;
+    vec3 dxOrigin, dxDirection;
+    vec3 dyOrigin, dyDirection;
 
     Ray(const vec3& o, const vec3& d, float t) :
         origin(o),
         direction(d),
         invDirection(vec3(1.0f) / d),
-        time(t)
+        time(t),
+        hasDifferentials(false)
     {
     }
 
@@ -2,6 +2,16 @@
 
 #include "math.hpp"
 
+// The samplers that the renderer can use
+typedef enum {
+    SamplerTypeSobol,   // Owen-scrambled Sobol, see SamplerSobol
+    SamplerTypeRandom,  // independent random numbers, see SamplerRandom
+} SamplerType;
+
+// A sampler generates the sample values for one path sample of one pixel.
+// Each call to in01() or in01x2() consumes the next dimension of the sample,
+// so the values depend only on the pixel, the sample index, and the dimension.
+// The static functions warp uniform samples to other distributions.
 class Sampler
 {
 public:
@@ -9,6 +19,19 @@ public:
     {
     }
 
+    // start sample number index for pixel (x,y); this resets the dimension
+    virtual void startSample(int x, int y, unsigned int index) = 0;
+
+    // start the given bounce (path segment) of the current sample; samplers
+    // may key the following dimensions by the bounce
+    virtual void startBounce(unsigned int bounce) = 0;
+
+    // return value of the next dimension uniformly distributed in [0,1)
+    virtual float in01() = 0;
+
+    // return values of the next dimension uniformly distributed in [0,1)^2
+    virtual vec2 in01x2() = 0;
+
     static vec3 uniformOnSphere(float u0, float u1)
     {
         float z = 1.0f - 2.0f * u0;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "sampler.hpp"
+#include "prng.hpp"
+
+// Purely random sampler: every dimension is an independent random number from
+// a counter-based generator keyed by (seed, pixel, sample index, bounce,
+// dimension).
+class SamplerRandom : public Sampler
+{
+public:
+    const uint64_t seed;
+    const int width;    // of the image, to number the pixels
+    Prng prng;
+
+    SamplerRandom(uint64_t seed, int width) : seed(seed), width(width), prng(seed)
+    {
+    }
+
+    virtual void startSample(int x, int y, unsigned int index) override
+    {
+        prng = Prng(seed, uint32_t(y) * uint32_t(width) + uint32_t(x), index);
+    }
+
+    virtual void startBounce(unsigned int bounce) override
+    {
+        prng.setBounce(bounce);
+    }
+
+    virtual float in01() override
+    {
+        return prng.in01();
+    }
+
+    virtual vec2 in01x2() override
+    {
+        float u0 = prng.in01();
+        float u1 = prng.in01();
+        return vec2(u0, u1);
+    }
+};
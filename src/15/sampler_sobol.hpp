@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+
+#include "sampler.hpp"
+#include "bluenoise.hpp"
+
+// Owen-scrambled Sobol sampler, following
+// "Practical Hash-based Owen Scrambling" by Burley, JCGT vol 9 no 4, 2020.
+// Each dimension uses the first one or two Sobol dimensions, with the sample
+// index shuffled and the values scrambled per pixel and dimension. This keeps
+// the samples of every dimension well stratified for any number of samples,
+// and the values only depend on (seed, pixel, sample index, dimension), so
+// rendering is progressive and deterministic.
+//
+// Optionally, the error is distributed as blue noise in screen space: all
+// pixels of a blue noise tile share the same scrambled samples, and each pixel
+// shifts them toroidally by the value of the blue noise mask at its position
+// (see "Blue-noise Dithered Sampling" by Georgiev and Fajardo, SIGGRAPH 2016).
+// This gives perceptually much better images with few samples per pixel.
+class SamplerSobol : public Sampler
+{
+public:
+    const uint32_t seed;
+    const bool blueNoise;
+    uint32_t pixelSeed;
+    uint32_t index;
+    uint32_t dimension;
+    int x, y;
+
+    SamplerSobol(uint32_t seed = 0, bool blueNoise = false) :
+        seed(seed), blueNoise(blueNoise), pixelSeed(0), index(0), dimension(0), x(0), y(0)
+    {
+    }
+
+    static uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static uint32_t hashCombine(uint32_t seed, uint32_t v)
+    {
+        return seed ^ (hash(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+    }
+
+    static uint32_t reverseBits(uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Laine-Karras style permutation: each bit only depends on lower bits
+    static uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed)
+    {
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return x;
+    }
+
+    // Owen scrambling: each bit only depends on higher bits
+    static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+    {
+        return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+    }
+
+    // The first Sobol dimension (van der Corput sequence)
+    static uint32_t sobol0(uint32_t i)
+    {
+        return reverseBits(i);
+    }
+
+    // The second Sobol dimension
+    static uint32_t sobol1(uint32_t i)
+    {
+        uint32_t v = 0x80000000u;
+        uint32_t x = 0;
+        for (; i != 0; i >>= 1) {
+            if (i & 1)
+                x ^= v;
+            v ^= v >> 1;
+        }
+        return x;
+    }
+
+    static float toFloat(uint32_t x)
+    {
+        return (x >> 8) * 0x1p-24f;
+    }
+
+    // seed for the current dimension; the dimension is advanced
+    uint32_t nextDimensionSeed()
+    {
+        return hashCombine(pixelSeed, dimension++);
+    }
+
+    // toroidal shift of a value by the blue noise mask; the mask offset
+    // depends on the dimension seed s so that dimensions are decorrelated
+    float blueNoiseShift(float v, uint32_t s) const
+    {
+        uint32_t h = hash(s);
+        int bx = (x + (h & 0xffff)) % blueNoiseSize;
+        int by = (y + (h >> 16)) % blueNoiseSize;
+        float shift = (blueNoiseRanks[by * blueNoiseSize + bx] + 0.5f) / (blueNoiseSize * blueNoiseSize);
+        return fract(v + shift);
+    }
+
+    virtual void startSample(int px, int py, unsigned int i) override
+    {
+        x = px;
+        y = py;
+        if (blueNoise)
+            pixelSeed = hashCombine(hashCombine(seed, x / blueNoiseSize), y / blueNoiseSize);
+        else
+            pixelSeed = hashCombine(hashCombine(seed, x), y);
+        index = i;
+        dimension = 0;
+    }
+
+    // the dimensions are numbered consecutively over the whole path, so that
+    // the first bounces get the best stratified ones; the bounce is not used
+    virtual void startBounce(unsigned int /* bounce */) override
+    {
+    }
+
+    virtual float in01() override
+    {
+        uint32_t s = nextDimensionSeed();
+        uint32_t i = nestedUniformScramble(index, s);
+        float v = toFloat(nestedUniformScramble(sobol0(i), hash(s + 1)));
+        if (blueNoise)
+            v = blueNoiseShift(v, s + 3);
+        return v;
+    }
+
+    virtual vec2 in01x2() override
+    {
+        uint32_t s = nextDimensionSeed();
+        uint32_t i = nestedUniformScramble(index, s);
+        vec2 v = vec2(toFloat(nestedUniformScramble(sobol0(i), hash(s + 1))),
+                      toFloat(nestedUniformScramble(sobol1(i), hash(s + 2))));
+        if (blueNoise)
+            v = vec2(blueNoiseShift(v.x(), s + 3), blueNoiseShift(v.y(), s + 4));
+        return v;
+    }
+};
@@ -4,15 +4,22 @@
 
 #include "animation.hpp"
 #include "texture.hpp"
+#include "texture_cache.hpp"
+#include "texture_compiler.hpp"
+#include "texture_registry.hpp"
 #include "envmap.hpp"
 #include "material.hpp"
 #include "surface.hpp"
 #include "mesh.hpp"
+#include "scene_cache.hpp"
 #include "bvh.hpp"
 
 class Scene
 {
 public:
+    std::unique_ptr<TextureCache> textureCache; // optional; used by the importer
+    std::unique_ptr<SceneCache> sceneCache;     // optional; used by the importer
+    TextureRegistry textureRegistry;            // the textures of all imports
     std::vector<std::unique_ptr<Animation>> animations;
     std::vector<std::unique_ptr<Texture>> textures;
     std::vector<std::unique_ptr<Material>> materials;
@@ -66,6 +73,19 @@ public:
         return map;
     }
 
+    // Compile the textures of all materials, see TextureCompiler; bakeable
+    // procedural textures are baked into images of the given size unless
+    // it is 0
+    void compileTextures(int bakeResolution = 0)
+    {
+        TextureCompiler compiler(bakeResolution);
+        for (size_t i = 0; i < materials.size(); i++)
+            materials[i]->compileTextures(compiler);
+        for (size_t i = 0; i < compiler.created.size(); i++)
+            take(compiler.created[i]);
+        compiler.report();
+    }
+
     void buildBVH(float t0, float t1)
     {
         bvh.build(surfaces, t0, t1);
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mesh.hpp"
+#include "texture_registry.hpp"
+#include "tiny_obj_loader.h"
+
+// A cache for imported scenes. After a file is imported, its materials and
+// meshes are written to a binary file in the cache directory. When the same
+// file is imported again, the cache file is memory mapped and the meshes view
+// its arrays directly, without parsing or copying. Textures are stored as
+// references to their image files; the TextureCache keeps their decoded
+// texels if it is enabled.
+// A cache file records the size, modification time and a hash of each file
+// the scene was imported from (the OBJ file and its MTL files). It is out of
+// date if the size of one of them changed, or if the modification time changed
+// and the contents changed too.
+class SceneCache
+{
+public:
+    static constexpr char magic[8] = { 'P', 'T', 'S', 'C', 'E', 'N', 'E', '1' };
+    static constexpr size_t alignment = 16;     // of the arrays in the file
+    static_assert(sizeof(vec3) == 3 * sizeof(float) && sizeof(vec2) == 2 * sizeof(float));
+
+    class FileHeader
+    {
+    public:
+        char magic[8];
+        uint32_t dependencies;
+        uint32_t materials;
+        uint32_t meshes;        // materials + 1, see Entry::meshes
+        uint32_t reserved;
+    };
+
+    // A file that a cached scene was imported from
+    class Dependency
+    {
+    public:
+        std::string fileName;
+        int64_t size;
+        int64_t mtime;
+        uint64_t hash;
+    };
+
+    // A cached scene
+    class Entry
+    {
+    public:
+        std::vector<tinyobj::material_t> materials;
+        // meshes[m]: the mesh that uses material m - 1 (m == 0: none), or
+        // nullptr; the meshes have no material yet and belong to the caller
+        std::vector<Mesh*> meshes;
+    };
+
+    std::string directory;
+    size_t hits, misses;
+
+    SceneCache(const std::string& directory) :
+        directory(directory), hits(0), misses(0)
+    {
+        mkdir(directory.c_str(), 0777);
+    }
+
+    // The cache file for a scene file, named after its canonical path
+    std::string cacheFileName(const std::string& fileName) const
+    {
+        char* canonical = realpath(fileName.c_str(), nullptr);
+        std::string key = canonical ? canonical : fileName;
+        free(canonical);
+        uint64_t hash = 0xcbf29ce484222325u;
+        for (size_t i = 0; i < key.size(); i++) {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 0x100000001b3u;
+        }
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return directory + "/" + hex + ".scene";
+    }
+
+    static bool getDependency(const std::string& fileName, Dependency& dep)
+    {
+        struct stat st;
+        if (stat(fileName.c_str(), &st) != 0)
+            return false;
+        dep.fileName = fileName;
+        dep.size = st.st_size;
+        dep.mtime = st.st_mtime;
+        return TextureRegistry::hashFile(fileName, dep.hash);
+    }
+
+    static bool isCurrent(const Dependency& dep)
+    {
+        struct stat st;
+        if (stat(dep.fileName.c_str(), &st) != 0 || st.st_size != dep.size)
+            return false;
+        if (st.st_mtime == dep.mtime)
+            return true;
+        uint64_t hash;
+        return TextureRegistry::hashFile(dep.fileName, hash) && hash == dep.hash;
+    }
+
+    // Sequential reading from a mapped file, with bounds checks
+    class Reader
+    {
+    public:
+        const char* base;
+        size_t size;
+        size_t offset;
+        bool ok;
+
+        Reader(const char* base, size_t size) : base(base), size(size), offset(0), ok(true)
+        {
+        }
+
+        const char* get(size_t n)
+        {
+            if (!ok || n > size - offset) {
+                ok = false;
+                return nullptr;
+            }
+            const char* p = base + offset;
+            offset += n;
+            return p;
+        }
+
+        template<typename T> T value()
+        {
+            T v {};
+            const char* p = get(sizeof(T));
+            if (p)
+                std::memcpy(&v, p, sizeof(T));
+            return v;
+        }
+
+        std::string string()
+        {
+            uint32_t n = value<uint32_t>();
+            const char* p = get(n);
+            return p ? std::string(p, n) : std::string();
+        }
+
+        template<typename T> std::span<const T> array(uint64_t n)
+        {
+            offset = std::min(size, (offset + alignment - 1) / alignment * alignment);
+            if (n > size / sizeof(T)) {
+                ok = false;
+                return std::span<const T>();
+            }
+            const char* p = get(n * sizeof(T));
+            return p ? std::span<const T>(reinterpret_cast<const T*>(p), n) : std::span<const T>();
+        }
+    };
+
+    // Sequential writing, see Reader
+    class Writer
+    {
+    public:
+        FILE* f;
+        size_t offset;
+        bool ok;
+
+        Writer(FILE* f) : f(f), offset(0), ok(true)
+        {
+        }
+
+        void put(const void* p, size_t n)
+        {
+            if (ok && n > 0)
+                ok = (fwrite(p, n, 1, f) == 1);
+            offset += n;
+        }
+
+        template<typename T> void value(const T& v)
+        {
+            put(&v, sizeof(T));
+        }
+
+        void string(const std::string& s)
+        {
+            value(uint32_t(s.size()));
+            put(s.data(), s.size());
+        }
+
+        template<typename T> void array(std::span<const T> a)
+        {
+            static const char zeros[alignment] = {};
+            put(zeros, (alignment - offset % alignment) % alignment);
+            put(a.data(), a.size() * sizeof(T));
+        }
+    };
+
+    static void readMaterial(Reader& r, tinyobj::material_t& M)
+    {
+        M.name = r.string();
+        for (int i = 0; i < 3; i++) {
+            M.diffuse[i] = r.value<float>();
+            M.specular[i] = r.value<float>();
+            M.emission[i] = r.value<float>();
+        }
+        M.shininess = r.value<float>();
+        M.bump_texopt.bump_multiplier = r.value<float>();
+        M.diffuse_texname = r.string();
+        M.specular_texname = r.string();
+        M.specular_highlight_texname = r.string();
+        M.alpha_texname = r.string();
+        M.normal_texname = r.string();
+        M.bump_texname = r.string();
+    }
+
+    static void writeMaterial(Writer& w, const tinyobj::material_t& M)
+    {
+        w.string(M.name);
+        for (int i = 0; i < 3; i++) {
+            w.value(M.diffuse[i]);
+            w.value(M.specular[i]);
+            w.value(M.emission[i]);
+        }
+        w.value(M.shininess);
+        w.value(M.bump_texopt.bump_multiplier);
+        w.string(M.diffuse_texname);
+        w.string(M.specular_texname);
+        w.string(M.specular_highlight_texname);
+        w.string(M.alpha_texname);
+        w.string(M.normal_texname);
+        w.string(M.bump_texname);
+    }
+
+    // Return the cached scene for a file, or nullptr if there is none that
+    // is up to date. The meshes get the given animation.
+    std::unique_ptr<Entry> open(const std::string& fileName, const Animation* anim = nullptr)
+    {
+        std::string cacheName = cacheFileName(fileName);
+        int fd = ::open(cacheName.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FileHeader)) {
+            if (fd >= 0)
+                close(fd);
+            misses++;
+            return nullptr;
+        }
+        size_t size = st.st_size;
+        void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) {
+            misses++;
+            return nullptr;
+        }
+        // the mapping lives as long as one of the meshes that view it
+        std::shared_ptr<const void> mapping(m, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+
+        Reader r(static_cast<const char*>(m), size);
+        FileHeader header = r.value<FileHeader>();
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.meshes != header.materials + 1) {
+            fprintf(stderr, "%s: invalid scene cache file\n", cacheName.c_str());
+            misses++;
+            return nullptr;
+        }
+        for (uint32_t i = 0; i < header.dependencies; i++) {
+            Dependency dep;
+            dep.fileName = r.string();
+            dep.size = r.value<int64_t>();
+            dep.mtime = r.value<int64_t>();
+            dep.hash = r.value<uint64_t>();
+            if (!r.ok || !isCurrent(dep)) {
+                if (r.ok)
+                    fprintf(stderr, "%s: scene cache is out of date\n", fileName.c_str());
+                misses++;
+                return nullptr;
+            }
+        }
+        std::unique_ptr<Entry> e = std::make_unique<Entry>();
+        e->materials.resize(r.ok ? header.materials : 0);
+        for (size_t i = 0; i < e->materials.size(); i++)
+            readMaterial(r, e->materials[i]);
+        for (uint32_t i = 0; r.ok && i < header.meshes; i++) {
+            uint64_t counts[5];
+            for (int j = 0; j < 5; j++)
+                counts[j] = r.value<uint64_t>();
+            std::span<const vec3> positions = r.array<vec3>(counts[0]);
+            std::span<const vec3> normals = r.array<vec3>(counts[1]);
+            std::span<const vec2> texcoords = r.array<vec2>(counts[2]);
+            std::span<const vec3> tangents = r.array<vec3>(counts[3]);
+            std::span<const unsigned int> indices = r.array<unsigned int>(counts[4]);
+            // the arrays must fit together, or rendering would read out of bounds
+            for (int j = 1; j < 4; j++)
+                if (counts[j] != 0 && counts[j] != counts[0])
+                    r.ok = false;
+            if (counts[4] % 3 != 0)
+                r.ok = false;
+            for (size_t j = 0; r.ok && j < indices.size(); j++)
+                if (indices[j] >= counts[0])
+                    r.ok = false;
+            Mesh* mesh = nullptr;
+            if (r.ok && indices.size() > 0)
+                mesh = new Mesh(positions, normals, texcoords, tangents, indices, mapping, nullptr, anim);
+            e->meshes.push_back(mesh);
+        }
+        if (!r.ok) {
+            fprintf(stderr, "%s: invalid scene cache file\n", cacheName.c_str());
+            for (size_t i = 0; i < e->meshes.size(); i++)
+                delete e->meshes[i];
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        return e;
+    }
+
+    // Write the cache file for a scene imported from the given files (the
+    // first one is the scene file itself). The file is written with a
+    // temporary name first and then renamed.
+    bool write(const std::vector<std::string>& sourceFileNames,
+            const std::vector<tinyobj::material_t>& materials,
+            const std::vector<Mesh*>& meshes)
+    {
+        std::vector<Dependency> deps(sourceFileNames.size());
+        for (size_t i = 0; i < deps.size(); i++)
+            if (!getDependency(sourceFileNames[i], deps[i]))
+                return false;
+        std::string cacheName = cacheFileName(sourceFileNames[0]);
+        std::string tmpName = cacheName + ".tmp";
+        FILE* f = fopen(tmpName.c_str(), "wb");
+        if (!f)
+            return false;
+        Writer w(f);
+        FileHeader header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.dependencies = deps.size();
+        header.materials = materials.size();
+        header.meshes = meshes.size();
+        header.reserved = 0;
+        w.value(header);
+        for (size_t i = 0; i < deps.size(); i++) {
+            w.string(deps[i].fileName);
+            w.value(deps[i].size);
+            w.value(deps[i].mtime);
+            w.value(deps[i].hash);
+        }
+        for (size_t i = 0; i < materials.size(); i++)
+            writeMaterial(w, materials[i]);
+        for (size_t i = 0; i < meshes.size(); i++) {
+            // a missing mesh is written as an empty one
+            std::span<const vec3> positions, normals, tangents;
+            std::span<const vec2> texcoords;
+            std::span<const unsigned int> indices;
+            if (meshes[i]) {
+                positions = meshes[i]->positions;
+                normals = meshes[i]->normals;
+                texcoords = meshes[i]->texcoords;
+                tangents = meshes[i]->tangents;
+                indices = meshes[i]->indices;
+            }
+            w.value(uint64_t(positions.size()));
+            w.value(uint64_t(normals.size()));
+            w.value(uint64_t(texcoords.size()));
+            w.value(uint64_t(tangents.size()));
+            w.value(uint64_t(indices.size()));
+            w.array(positions);
+            w.array(normals);
+            w.array(texcoords);
+            w.array(tangents);
+            w.array(indices);
+        }
+        bool ok = w.ok;
+        ok = (fclose(f) == 0) && ok;
+        if (ok)
+            ok = (rename(tmpName.c_str(), cacheName.c_str()) == 0);
+        if (!ok)
+            remove(tmpName.c_str());
+        return ok;
+    }
+
+    void report(FILE* f = stderr) const
+    {
+        fprintf(f, "Scene cache: %zu hits, %zu misses\n", hits, misses);
+    }
+};
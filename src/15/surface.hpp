@@ -2,6 +2,9 @@
 
 #include "math.hpp"
 #include "aabb.hpp"
+#include "ray.hpp"
+#include "sampler.hpp"
+#include "hasher.hpp"
 
 class Surface;
 class Material;
@@ -14,6 +17,7 @@ public:
     vec3 position;      // hit position = ray.origin + a * ray.direction
     vec3 normal;        // normal at hit position; always points towards the ray, also for back sides
     vec2 texcoord;      // texture coordinates at hit position
+    vec2 dtdx, dtdy;    // derivatives of the texture coordinates in image x and y direction; zero if unknown
     vec3 tangent;       // tangent at hit position
     bool backside;      // flag: was the hit on the backside? (the normal is flipped then)
     const Surface* surface; // the surface
@@ -24,9 +28,34 @@ public:
     }
 
     HitRecord(float a, const vec3& p, const vec3& n, const vec2& tc, const vec3& t, bool bs, const Surface* s, const Material* m) :
-        haveHit(true), a(a), position(p), normal(n), texcoord(tc), tangent(t), backside(bs), surface(s), material(m)
+        haveHit(true), a(a), position(p), normal(n), texcoord(tc), dtdx(0.0f), dtdy(0.0f), tangent(t), backside(bs), surface(s), material(m)
     {
     }
+
+    // Compute dtdx and dtdy from the ray differentials, given the derivatives
+    // of the position with respect to the texture coordinates: the offset rays
+    // are intersected with the tangent plane, and the offsets of the
+    // intersections are expressed in texture coordinates (least squares).
+    void computeDifferentials(const Ray& ray, const vec3& dpdu, const vec3& dpdv)
+    {
+        if (!ray.hasDifferentials)
+            return;
+        float cosX = dot(normal, ray.dxDirection);
+        float cosY = dot(normal, ray.dyDirection);
+        if (std::abs(cosX) < 1e-6f || std::abs(cosY) < 1e-6f)
+            return;
+        vec3 dpdx = ray.dxOrigin + (dot(normal, position - ray.dxOrigin) / cosX) * ray.dxDirection - position;
+        vec3 dpdy = ray.dyOrigin + (dot(normal, position - ray.dyOrigin) / cosY) * ray.dyDirection - position;
+        float uu = dot(dpdu, dpdu);
+        float uv = dot(dpdu, dpdv);
+        float vv = dot(dpdv, dpdv);
+        float det = uu * vv - uv * uv;
+        if (det <= 1e-6f * uu * vv)
+            return;
+        float invDet = 1.0f / det;
+        dtdx = invDet * vec2(vv * dot(dpdu, dpdx) - uv * dot(dpdv, dpdx), uu * dot(dpdv, dpdx) - uv * dot(dpdu, dpdx));
+        dtdy = invDet * vec2(vv * dot(dpdu, dpdy) - uv * dot(dpdv, dpdy), uu * dot(dpdv, dpdy) - uv * dot(dpdu, dpdy));
+    }
 };
 
 class Surface
@@ -42,7 +71,7 @@ public:
         return HitRecord();
     }
 
-    virtual vec3 direction(const vec3& /* origin */, float /* t */, Prng& /* prng */) const
+    virtual vec3 direction(const vec3& /* origin */, float /* t */, Sampler& /* sampler */) const
     {
         return vec3(0.0f);
     }
@@ -51,4 +80,7 @@ public:
     {
         return 0.0f;
     }
+
+    // Add the geometry and the material of the surface to the hash
+    virtual void hash(Hasher& hasher) const = 0;
 };
@@ -33,7 +33,19 @@ private:
             n = -n;
         }
 
-        return HitRecord(a, p, n, tc, t, backside, this, material);
+        HitRecord hr(a, p, n, tc, t, backside, this, material);
+        if (ray.hasDifferentials) {
+            // derivatives of the position with respect to the texture coordinates;
+            // they are computed in the rotated frame of rn and then mapped back
+            // to world space, where the position and the ray differentials are
+            float r = length(p - transformedCenter);
+            float cosBeta = std::sqrt(std::max(0.0f, 1.0f - rn.y() * rn.y()));
+            vec3 dpdu = (2.0f * pi * r * cosBeta) * t;
+            vec3 dpdv = (pi * r) * vec3(-rn.y() * std::sin(alpha), cosBeta, -rn.y() * std::cos(alpha));
+            quat toWorld = inverse(T.rotation);
+            hr.computeDifferentials(ray, toWorld * dpdu, toWorld * dpdv);
+        }
+        return hr;
     }
 
 public:
@@ -114,7 +126,7 @@ public:
         return hit(c, r, T, ray, amin, amax);
     }
 
-    virtual vec3 direction(const vec3& origin, float t, Prng& prng) const override
+    virtual vec3 direction(const vec3& origin, float t, Sampler& sampler) const override
     {
         vec3 c;
         float r;
@@ -122,17 +134,18 @@ public:
         getCR(t, c, r, T);
 
         vec3 dir;
+        vec2 u = sampler.in01x2();
         vec3 cmo = c - origin;
         float distanceSquared = dot(cmo, cmo);
         float radiusSquared = r * r;
         if (distanceSquared <= radiusSquared) {
             // We are inside the sphere. Any direction will hit the sphere.
-            dir = Sampler::uniformOnSphere(prng.in01(), prng.in01());
+            dir = Sampler::uniformOnSphere(u.x(), u.y());
         } else {
             // We are outside the sphere. Generate a direction that hits it.
             float discriminant = 1.0f - radiusSquared / distanceSquared;
             float cosThetaMax = std::sqrt(std::max(0.0f, discriminant));
-            vec3 vectorAroundCmo = Sampler::uniformTowardsSphere(cosThetaMax, prng.in01(), prng.in01());
+            vec3 vectorAroundCmo = Sampler::uniformTowardsSphere(cosThetaMax, u.x(), u.y());
             dir = normalize(TangentSpace(normalize(cmo)).toWorldSpace(vectorAroundCmo));
         }
         return dir;
@@ -166,4 +179,12 @@ public:
         }
         return v;
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(center);
+        hasher.add(radius);
+        hasher.addObject(material);
+        hasher.addObject(animation);
+    }
 };
@@ -172,15 +172,29 @@ public:
             tng = vec3(0.0f);
         }
         tng = normalize(tng);
-        return HitRecord(alpha, pos, nrm, tc, tng, backside, this, mesh.material);
+        HitRecord hr(alpha, pos, nrm, tc, tng, backside, this, mesh.material);
+        if (ray.hasDifferentials && mesh.texcoords.size() > 0) {
+            // derivatives of the position with respect to the texture coordinates
+            vec2 duv1 = mesh.texcoords[i1] - mesh.texcoords[i0];
+            vec2 duv2 = mesh.texcoords[i2] - mesh.texcoords[i0];
+            float det = duv1.x() * duv2.y() - duv1.y() * duv2.x();
+            if (std::abs(det) > std::numeric_limits<float>::epsilon()) {
+                float invDet = 1.0f / det;
+                vec3 dpdu = invDet * (duv2.y() * e1 - duv1.y() * e2);
+                vec3 dpdv = invDet * (duv1.x() * e2 - duv2.x() * e1);
+                hr.computeDifferentials(ray, dpdu, dpdv);
+            }
+        }
+        return hr;
     }
 
-    virtual vec3 direction(const vec3& origin, float t, Prng& prng) const override
+    virtual vec3 direction(const vec3& origin, float t, Sampler& sampler) const override
     {
         unsigned int i0, i1, i2;
         vec3 A, B, C;
         getVerticesUntransformed(i0, i1, i2, A, B, C);
-        vec3 bary = Sampler::uniformInTriangle(prng.in01(), prng.in01());
+        vec2 u = sampler.in01x2();
+        vec3 bary = Sampler::uniformInTriangle(u.x(), u.y());
         vec3 P = vec3(bary.x() * A + bary.y() * B + bary.z() * C);
         if (mesh.animation)
             P = mesh.animation->at(t) * P;
@@ -206,6 +220,12 @@ public:
         float distanceSquared = hr.a * hr.a;
         return distanceSquared / (cosine * faceArea);
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(&mesh);
+        hasher.add(uint64_t(indices - mesh.indices.data()));
+    }
 };
 
 Surface* createSurfaceTriangle(const Mesh& mesh, const unsigned int* indices)
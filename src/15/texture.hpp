@@ -1,9 +1,72 @@
 #pragma once
 
 #include "math.hpp"
+#include "hasher.hpp"
+
+class TextureCompiler;
 
 class Texture
 {
 public:
+    bool isConstant = false;    // set by TextureConstant: the value is the same everywhere
+    vec3 constantValue;
+
     virtual vec3 value(const vec2& /* texcoord */, float /* time */) const = 0;
+
+    // The value filtered over the footprint of a pixel, given by the
+    // derivatives of the texture coordinates in image x and y direction.
+    // Textures that cannot filter return the unfiltered value.
+    virtual vec3 filteredValue(const vec2& texcoord, const vec2& /* dtdx */, const vec2& /* dtdy */, float time) const
+    {
+        return value(texcoord, time);
+    }
+
+    // The first component of the values at the frequencies freq, 2 freq,
+    // 4 freq, ..., e.g. the octaves of fractal noise. Noise textures
+    // override this to evaluate all octaves in one call.
+    virtual void octaves(const vec2& texcoord, float freq, int count, float time, float* values) const
+    {
+        for (int i = 0; i < count; i++) {
+            values[i] = value(texcoord * freq, time).x();
+            freq *= 2.0f;
+        }
+    }
+
+    // value() and filteredValue() without a virtual call for constant textures
+    vec3 lookup(const vec2& texcoord, float time) const
+    {
+        return isConstant ? constantValue : value(texcoord, time);
+    }
+
+    vec3 filteredLookup(const vec2& texcoord, const vec2& dtdx, const vec2& dtdy, float time) const
+    {
+        return isConstant ? constantValue : filteredValue(texcoord, dtdx, dtdy, time);
+    }
+
+    // Return a texture that computes the same values with less work, e.g.
+    // with constant subtrees folded; see TextureCompiler. New textures are
+    // created with the compiler, which also compiles the children.
+    virtual const Texture* compile(TextureCompiler& /* compiler */) const
+    {
+        return this;
+    }
+
+    // Whether the texture may be replaced by an image of its values for
+    // texture coordinates in [0,1]^2: it must be periodic with period 1 and
+    // must not depend on time.
+    virtual bool bakeable() const
+    {
+        return false;
+    }
+
+    // The width in texels of the image that the values come from, or 0 if
+    // the texture has no texels, e.g. for constant or procedural textures
+    virtual int texelWidth() const
+    {
+        return 0;
+    }
+
+    // Add the parameters and data that the values depend on to the hash;
+    // child textures are added with Hasher::addObject()
+    virtual void hash(Hasher& hasher) const = 0;
 };
@@ -0,0 +1,468 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "texture.hpp"
+#include "texture_image.hpp"
+#include "texture_filter.hpp"
+#include "texture_registry.hpp"
+
+// A cache for image textures that do not all fit into memory. Each texture is
+// converted once into a tiled, mip-mapped file in the cache directory, with
+// the texels in the storage format of the TextureImage (see TexelFormat).
+// Tiles are read from that file when they are first accessed, and when the
+// memory budget is used up they are evicted in approximately least recently
+// used order (CLOCK algorithm). All tiles have the same size in bytes, so that
+// any tile fits into any slot: they are tileWidth texels wide and as high as
+// the texel size of their texture allows.
+// Lookups of cached tiles take no lock: each slot that holds a tile has a
+// version that is odd while the slot is refilled, and a reader only accepts a
+// texel if the version did not change while it read it (a seqlock).
+class TextureCache
+{
+public:
+    static constexpr int tileWidth = 32;
+    // divisible by tileWidth times every texel size (1, 2, 3, 4, 6, 8, 12)
+    static constexpr size_t tileBytes = tileWidth * 32 * 12;
+    static constexpr uint64_t noOwner = ~uint64_t(0);
+    static constexpr char magic[8] = { 'P', 'T', 'T', 'I', 'L', 'E', 'D', '2' };
+
+    // The tiled file starts with this header. The source image is identified
+    // by its size and modification time, and by a hash of its contents so
+    // that a file that was only touched or copied does not invalidate it.
+    class FileHeader
+    {
+    public:
+        char magic[8];
+        int64_t sourceSize;
+        int64_t sourceMtime;
+        uint64_t sourceHash;
+        int32_t width, height;
+        int32_t levels;
+        int32_t tileWidth;
+        int32_t channels;
+        int32_t format;                 // a TexelFormat
+        float decodeTable[256];         // see TextureImage
+    };
+
+    class alignas(64) ThreadCounters
+    {
+    public:
+        uint64_t hits;
+        uint64_t misses;
+
+        ThreadCounters() : hits(0), misses(0)
+        {
+        }
+    };
+
+    // A texture in the cache
+    class Entry
+    {
+    public:
+        std::string name;
+        std::string variant;                // see open()
+        int fd;
+        uint64_t sourceHash;                // of the contents of the source image
+        int channels;
+        TexelFormat format;
+        int texelBytes;
+        int tileHeight;
+        float decodeTable[256];
+        std::vector<int> widths, heights;   // per mip level
+        std::vector<int> tilesX;            // per mip level
+        std::vector<uint32_t> firstTile;    // per mip level: index of its first tile in the file
+        std::unique_ptr<std::atomic<int32_t>[]> tileSlots; // per tile: its slot, or -1
+        std::vector<ThreadCounters> counters; // per thread
+    };
+
+    // A slot holds one tile
+    class Slot
+    {
+    public:
+        std::atomic<uint32_t> version;
+        std::atomic<uint64_t> owner;        // (texture << 32) | tile, or noOwner
+        std::atomic<uint8_t> referenced;    // accessed since the CLOCK hand passed
+
+        Slot() : version(0), owner(noOwner), referenced(0)
+        {
+        }
+    };
+
+    std::string directory;
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<Slot> slots;
+    std::unique_ptr<std::atomic<uint32_t>[]> slotWords; // tileBytes / 4 words per slot
+    std::mutex mutex;   // for loading tiles and for adding entries
+    size_t clockHand;
+    uint64_t evictions;
+
+    static int maxThreads()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    static int threadNum()
+    {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    // The cache keeps at most budget bytes of texels in memory, but at least
+    // a few tiles per thread
+    TextureCache(const std::string& directory, size_t budget) :
+        directory(directory),
+        slots(std::max(budget / tileBytes, size_t(16 * maxThreads()))),
+        slotWords(new std::atomic<uint32_t>[slots.size() * tileBytes / 4]),
+        clockHand(0), evictions(0)
+    {
+        mkdir(directory.c_str(), 0777);
+    }
+
+    ~TextureCache()
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+            close(entries[i]->fd);
+    }
+
+    // Whether the tiled file with this header was created from the current
+    // version of the source file
+    static bool isCurrent(const FileHeader& header, const std::string& fileName, const struct stat& st)
+    {
+        if (header.sourceSize != st.st_size)
+            return false;
+        if (header.sourceMtime == st.st_mtime)
+            return true;
+        uint64_t hash;
+        return TextureRegistry::hashFile(fileName, hash) && hash == header.sourceHash;
+    }
+
+    // Open a tiled file and read its header; returns the file descriptor, or
+    // -1 if the file does not exist or is not a valid tiled file
+    static int openTiledFile(const std::string& fileName, FileHeader& header)
+    {
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            return -1;
+        if (pread(fd, &header, sizeof(header), 0) != ssize_t(sizeof(header))
+                || std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.tileWidth != tileWidth
+                || header.width <= 0 || header.height <= 0 || header.levels <= 0 || header.levels > 32
+                || (header.channels != 1 && header.channels != 3)
+                || header.format < TexelUnorm8 || header.format > TexelFloat) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Add the texture for an image file and return its index, or -1 on
+    // failure. The tiled file is only created (with the image from decode())
+    // if it does not exist yet or the image file changed; variant
+    // distinguishes different conversions of the same file. Several threads
+    // may open textures at the same time.
+    int open(const std::string& fileName, const std::string& variant,
+            const std::function<std::unique_ptr<TextureImage>()>& decode)
+    {
+        uint64_t hash = 0xcbf29ce484222325u;
+        std::string key = fileName + '\n' + variant;
+        for (size_t i = 0; i < key.size(); i++) {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 0x100000001b3u;
+        }
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        std::string tiledFileName = directory + "/" + hex + ".tiled";
+
+        struct stat sourceStat;
+        if (stat(fileName.c_str(), &sourceStat) != 0)
+            return -1;
+        FileHeader header;
+        int fd = openTiledFile(tiledFileName, header);
+        if (fd >= 0 && !isCurrent(header, fileName, sourceStat)) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd < 0) {
+            uint64_t sourceHash;
+            if (!TextureRegistry::hashFile(fileName, sourceHash))
+                return -1;
+            std::unique_ptr<TextureImage> img = decode();
+            if (!img || !writeTiledFile(tiledFileName, *img, sourceStat, sourceHash))
+                return -1;
+            fd = openTiledFile(tiledFileName, header);
+        }
+
+        std::unique_ptr<Entry> e = std::make_unique<Entry>();
+        e->name = fileName;
+        e->variant = variant;
+        e->fd = fd;
+        if (e->fd >= 0) {
+            e->sourceHash = header.sourceHash;
+            e->channels = header.channels;
+            e->format = static_cast<TexelFormat>(header.format);
+            e->texelBytes = texelBytes(e->format, e->channels);
+            e->tileHeight = tileBytes / (tileWidth * e->texelBytes);
+            std::memcpy(e->decodeTable, header.decodeTable, sizeof(e->decodeTable));
+        }
+        int w = header.width;
+        int h = header.height;
+        uint32_t tiles = 0;
+        for (int l = 0; e->fd >= 0 && l < header.levels; l++) {
+            e->widths.push_back(w);
+            e->heights.push_back(h);
+            e->tilesX.push_back((w + tileWidth - 1) / tileWidth);
+            e->firstTile.push_back(tiles);
+            tiles += e->tilesX.back() * ((h + e->tileHeight - 1) / e->tileHeight);
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+        struct stat tiledStat;
+        if (e->fd < 0 || fstat(e->fd, &tiledStat) != 0
+                || tiledStat.st_size != off_t(sizeof(FileHeader) + tiles * tileBytes)) {
+            fprintf(stderr, "%s: invalid tiled texture file\n", tiledFileName.c_str());
+            if (e->fd >= 0)
+                close(e->fd);
+            return -1;
+        }
+        e->tileSlots.reset(new std::atomic<int32_t>[tiles]);
+        for (uint32_t t = 0; t < tiles; t++)
+            e->tileSlots[t].store(-1);
+        e->counters.resize(maxThreads());
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(std::move(e));
+        return entries.size() - 1;
+    }
+
+    // Write the mip levels of an image as tiles of its stored texels; at the
+    // right and top borders, the tiles are filled by repeating the last
+    // texel. The file is written with a temporary name first and then renamed.
+    static bool writeTiledFile(const std::string& fileName, const TextureImage& img,
+            const struct stat& sourceStat, uint64_t sourceHash)
+    {
+        std::string tmpName = fileName + ".tmp";
+        FILE* f = fopen(tmpName.c_str(), "wb");
+        if (!f)
+            return false;
+        FileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.sourceSize = sourceStat.st_size;
+        header.sourceMtime = sourceStat.st_mtime;
+        header.sourceHash = sourceHash;
+        header.width = img.width;
+        header.height = img.height;
+        header.levels = img.levels();
+        header.tileWidth = tileWidth;
+        header.channels = img.channels;
+        header.format = img.format;
+        std::memcpy(header.decodeTable, img.decodeTable, sizeof(header.decodeTable));
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        int bytes = texelBytes(img.format, img.channels);
+        int tileHeight = tileBytes / (tileWidth * bytes);
+        std::vector<unsigned char> tile(tileBytes);
+        for (int l = 0; ok && l < img.levels(); l++) {
+            int w = img.levelWidth(l);
+            int h = img.levelHeight(l);
+            const unsigned char* data = img.levelData[l].data();
+            for (int ty = 0; ok && ty < (h + tileHeight - 1) / tileHeight; ty++) {
+                for (int tx = 0; ok && tx < (w + tileWidth - 1) / tileWidth; tx++) {
+                    for (int y = 0; y < tileHeight; y++) {
+                        size_t row = size_t(std::min(ty * tileHeight + y, h - 1)) * w;
+                        for (int x = 0; x < tileWidth; x++) {
+                            size_t i = row + std::min(tx * tileWidth + x, w - 1);
+                            std::memcpy(&tile[(y * tileWidth + x) * bytes], data + i * bytes, bytes);
+                        }
+                    }
+                    ok = fwrite(tile.data(), tileBytes, 1, f) == 1;
+                }
+            }
+        }
+        ok = (fclose(f) == 0) && ok;
+        if (ok)
+            ok = (std::rename(tmpName.c_str(), fileName.c_str()) == 0);
+        else
+            std::remove(tmpName.c_str());
+        return ok;
+    }
+
+    vec3 texel(int texture, int level, int x, int y)
+    {
+        Entry& e = *entries[texture];
+        uint32_t tile = e.firstTile[level] + (y / e.tileHeight) * e.tilesX[level] + x / tileWidth;
+        size_t offset = ((y % e.tileHeight) * tileWidth + x % tileWidth) * e.texelBytes;
+        // the words that contain the texel
+        size_t firstWord = offset / 4;
+        size_t words = (offset + e.texelBytes + 3) / 4 - firstWord;
+        uint64_t key = (uint64_t(texture) << 32) | tile;
+        int thread = threadNum();
+        ThreadCounters* counters = (thread < int(e.counters.size()) ? &e.counters[thread] : nullptr);
+        for (;;) {
+            int32_t s = e.tileSlots[tile].load(std::memory_order_acquire);
+            if (s >= 0) {
+                Slot& slot = slots[s];
+                uint32_t version = slot.version.load(std::memory_order_acquire);
+                if (!(version & 1) && slot.owner.load(std::memory_order_relaxed) == key) {
+                    const std::atomic<uint32_t>* p = &slotWords[s * (tileBytes / 4) + firstWord];
+                    uint32_t buffer[4];
+                    for (size_t i = 0; i < words; i++)
+                        buffer[i] = p[i].load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot.version.load(std::memory_order_relaxed) == version) {
+                        if (!slot.referenced.load(std::memory_order_relaxed))
+                            slot.referenced.store(1, std::memory_order_relaxed);
+                        if (counters)
+                            counters->hits++;
+                        return decodeTexel(reinterpret_cast<const unsigned char*>(buffer) + offset % 4,
+                                e.format, e.channels, e.decodeTable);
+                    }
+                }
+            }
+            if (counters)
+                counters->misses++;
+            load(texture, tile);
+        }
+    }
+
+    // Read a tile from its file into a slot. The file is read without holding
+    // the lock, so that threads can load different tiles concurrently.
+    void load(int texture, uint32_t tile)
+    {
+        Entry& e = *entries[texture];
+        std::vector<uint32_t> buffer(tileBytes / 4);
+        off_t fileOffset = sizeof(FileHeader) + off_t(tile) * tileBytes;
+        if (pread(e.fd, buffer.data(), tileBytes, fileOffset) != ssize_t(tileBytes)) {
+            fprintf(stderr, "%s: cannot read tile %u from tiled texture file\n", e.name.c_str(), tile);
+            buffer.assign(tileBytes / 4, 0);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (e.tileSlots[tile].load(std::memory_order_relaxed) >= 0)
+            return; // another thread was faster
+        // find a slot that was not referenced since the hand last passed it
+        size_t s;
+        for (;;) {
+            s = clockHand;
+            clockHand = (clockHand + 1) % slots.size();
+            if (slots[s].owner.load(std::memory_order_relaxed) == noOwner)
+                break;
+            if (!slots[s].referenced.load(std::memory_order_relaxed))
+                break;
+            slots[s].referenced.store(0, std::memory_order_relaxed);
+        }
+        Slot& slot = slots[s];
+        uint64_t oldOwner = slot.owner.load(std::memory_order_relaxed);
+        if (oldOwner != noOwner) {
+            entries[oldOwner >> 32]->tileSlots[uint32_t(oldOwner)].store(-1, std::memory_order_relaxed);
+            evictions++;
+        }
+        slot.version.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::atomic<uint32_t>* p = &slotWords[s * (tileBytes / 4)];
+        for (size_t i = 0; i < tileBytes / 4; i++)
+            p[i].store(buffer[i], std::memory_order_relaxed);
+        slot.owner.store((uint64_t(texture) << 32) | tile, std::memory_order_relaxed);
+        slot.version.fetch_add(1, std::memory_order_release);
+        slot.referenced.store(1, std::memory_order_relaxed);
+        e.tileSlots[tile].store(s, std::memory_order_release);
+    }
+
+    void report(FILE* f = stderr) const
+    {
+        fprintf(f, "Texture cache: %zu tiles of %zu KiB, %llu evictions\n", slots.size(),
+                tileBytes / 1024, static_cast<unsigned long long>(evictions));
+        for (size_t t = 0; t < entries.size(); t++) {
+            const Entry& e = *entries[t];
+            uint64_t hits = 0, misses = 0;
+            for (size_t i = 0; i < e.counters.size(); i++) {
+                hits += e.counters[i].hits;
+                misses += e.counters[i].misses;
+            }
+            fprintf(f, "  %s (%dx%d): %llu hits, %llu misses, %.2f%% hit rate\n", e.name.c_str(),
+                    e.widths[0], e.heights[0], static_cast<unsigned long long>(hits),
+                    static_cast<unsigned long long>(misses),
+                    hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+        }
+    }
+};
+
+// An image texture whose texels come from a TextureCache
+class TextureTiled : public Texture
+{
+public:
+    TextureCache* cache;
+    int id;
+
+    TextureTiled(TextureCache* cache, int id) : cache(cache), id(id)
+    {
+    }
+
+    int levels() const
+    {
+        return cache->entries[id]->widths.size();
+    }
+
+    int levelWidth(int level) const
+    {
+        return cache->entries[id]->widths[level];
+    }
+
+    int levelHeight(int level) const
+    {
+        return cache->entries[id]->heights[level];
+    }
+
+    vec3 texel(int level, int x, int y) const
+    {
+        return cache->texel(id, level, x, y);
+    }
+
+    virtual vec3 value(const vec2& texcoord, float /* time */) const override
+    {
+        return filterBilinear(*this, 0, texcoord);
+    }
+
+    virtual vec3 filteredValue(const vec2& texcoord, const vec2& dtdx, const vec2& dtdy, float /* time */) const override
+    {
+        return filterAnisotropic(*this, texcoord, dtdx, dtdy);
+    }
+
+    virtual int texelWidth() const override
+    {
+        return levelWidth(0);
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        // the tiled file is identified by its source image, its contents,
+        // and the conversion
+        const TextureCache::Entry& e = *cache->entries[id];
+        hasher.addArray(e.name.data(), e.name.size());
+        hasher.addArray(e.variant.data(), e.variant.size());
+        hasher.add(e.sourceHash);
+        hasher.addArray(e.widths.data(), e.widths.size());
+        hasher.addArray(e.heights.data(), e.heights.size());
+    }
+};
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cmath>
+#include <algorithm>
+
 #include "texture.hpp"
+#include "texture_compiler.hpp"
 
 class TextureChecker : public Texture
 {
@@ -15,13 +19,60 @@ public:
 
     virtual vec3 value(const vec2& texcoord, float t) const override
     {
-        int col = texcoord.x() * n;
-        int row = texcoord.y() * m;
+        // floor instead of truncation, so that cells have the same size and
+        // alternate on both sides of 0, as in filteredValue()
+        int col = std::floor(texcoord.x() * n);
+        int row = std::floor(texcoord.y() * m);
         vec3 v;
-        if (row % 2 == col % 2)
-            v = t0->value(texcoord, t);
+        if ((row & 1) == (col & 1))
+            v = t0->lookup(texcoord, t);
         else
-            v = t1->value(texcoord, t);
+            v = t1->lookup(texcoord, t);
         return v;
     }
+
+    // Box filter the checker pattern over the footprint: the integral of the
+    // pattern has a closed form, so the fraction of the footprint that is
+    // covered by t1 can be computed exactly.
+    virtual vec3 filteredValue(const vec2& texcoord, const vec2& dtdx, const vec2& dtdy, float t) const override
+    {
+        float s = texcoord.x() * n;
+        float r = texcoord.y() * m;
+        float ds = 0.5f * std::max(std::abs(dtdx.x()), std::abs(dtdy.x())) * n;
+        float dr = 0.5f * std::max(std::abs(dtdx.y()), std::abs(dtdy.y())) * m;
+        float s0 = s - ds, s1 = s + ds;
+        float r0 = r - dr, r1 = r + dr;
+        if (std::floor(s0) == std::floor(s1) && std::floor(r0) == std::floor(r1))
+            return value(texcoord, t);
+        // integral of the function that is 1 in odd and 0 in even cells
+        auto oddIntegral = [](float x) {
+            float h = std::floor(0.5f * x);
+            return h + 2.0f * std::max(0.5f * x - h - 0.5f, 0.0f);
+        };
+        float oddS = (ds > 0.0f ? (oddIntegral(s1) - oddIntegral(s0)) / (s1 - s0) : float(int(std::floor(s)) & 1));
+        float oddR = (dr > 0.0f ? (oddIntegral(r1) - oddIntegral(r0)) / (r1 - r0) : float(int(std::floor(r)) & 1));
+        // the fraction of cells where row and column differ in parity
+        float w1 = oddS + oddR - 2.0f * oddS * oddR;
+        return mix(t0->filteredLookup(texcoord, dtdx, dtdy, t), t1->filteredLookup(texcoord, dtdx, dtdy, t), w1);
+    }
+
+    // A checker pattern of two equal constants is a constant
+    virtual const Texture* compile(TextureCompiler& compiler) const override
+    {
+        const Texture* c0 = compiler.compile(t0);
+        const Texture* c1 = compiler.compile(t1);
+        if (c0->isConstant && c1->isConstant && c0->constantValue == c1->constantValue)
+            return c0;
+        if (c0 == t0 && c1 == t1)
+            return this;
+        return compiler.add(new TextureChecker(c0, c1, n, m));
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(t0);
+        hasher.addObject(t1);
+        hasher.add(n);
+        hasher.add(m);
+    }
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdio>
+
+#include "texture.hpp"
+#include "texture_constant.hpp"
+#include "texture_image.hpp"
+
+// Compiles texture graphs at scene build time: constant subtrees are folded
+// into a single TextureConstant, chains of nodes are merged (see the compile()
+// functions of the textures), and optionally bakeable procedural textures are
+// replaced by mipmapped images. Textures shared by several materials are
+// compiled only once. The new textures belong to the caller, see created.
+class TextureCompiler
+{
+public:
+    int bakeResolution;                                 // 0: do not bake
+    std::map<const Texture*, const Texture*> compiled;
+    std::vector<Texture*> created;
+    size_t folded;                                      // number of nodes replaced by compiling
+    size_t baked;                                       // number of nodes replaced by images
+
+    TextureCompiler(int bakeResolution = 0) :
+        bakeResolution(bakeResolution), folded(0), baked(0)
+    {
+    }
+
+    // Take ownership of a new texture
+    Texture* add(Texture* tex)
+    {
+        created.push_back(tex);
+        return tex;
+    }
+
+    const Texture* constant(const vec3& v)
+    {
+        return add(new TextureConstant(v));
+    }
+
+    const Texture* compile(const Texture* tex)
+    {
+        if (!tex)
+            return nullptr;
+        auto it = compiled.find(tex);
+        if (it != compiled.end())
+            return it->second;
+        const Texture* result = tex->compile(*this);
+        if (bakeResolution > 0 && !result->isConstant && result->bakeable()) {
+            result = bake(result);
+            baked++;
+        }
+        if (result != tex)
+            folded++;
+        compiled.insert(std::make_pair(tex, result));
+        return result;
+    }
+
+    const Texture* bake(const Texture* tex)
+    {
+        int n = bakeResolution;
+        std::vector<vec3> img(size_t(n) * n);
+        #pragma omp parallel for
+        for (int y = 0; y < n; y++)
+            for (int x = 0; x < n; x++)
+                img[size_t(y) * n + x] = tex->value(vec2((x + 0.5f) / n, (y + 0.5f) / n), 0.0f);
+        TextureImage* image = new TextureImage(img, n, n,
+                TextureImage::fitsHalf(img) ? TexelHalf : TexelFloat);
+        return add(image);
+    }
+
+    void report(FILE* f = stderr) const
+    {
+        fprintf(f, "Texture compilation: %zu textures, %zu replaced", compiled.size(), folded);
+        if (bakeResolution > 0)
+            fprintf(f, ", %zu of them baked to %dx%d images", baked, bakeResolution, bakeResolution);
+        fprintf(f, "\n");
+    }
+};
@@ -9,10 +9,17 @@ public:
 
     TextureConstant(const vec3& v) : val(v)
     {
+        isConstant = true;
+        constantValue = v;
     }
 
     virtual vec3 value(const vec2& /* texcoord */, float /* time */) const override
     {
         return val;
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(val);
+    }
 };
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+#include "math.hpp"
+
+// Filtering of mip-mapped image textures. The texture type T must provide
+// levels(), levelWidth(level), levelHeight(level), and texel(level, x, y).
+
+// Bilinear interpolation in the given mip level
+template<typename T> vec3 filterBilinear(const T& tex, int level, const vec2& texcoord)
+{
+    int w = tex.levelWidth(level);
+    int h = tex.levelHeight(level);
+    // use only the fractional part of the texture coordinate so that
+    // it is in [0,1) and no over- or underflow can occur
+    float u = fract(texcoord.x());
+    float v = fract(texcoord.y());
+    float s = u * w - 0.5f;
+    if (s < 0.0f)
+        s = 0.0f;
+    float t = v * h - 0.5f;
+    if (t < 0.0f)
+        t = 0.0f;
+    int x0 = s;
+    int y0 = t;
+    int x1 = x0 + 1;
+    if (x1 >= w)
+        x1 = w - 1;
+    int y1 = y0 + 1;
+    if (y1 >= h)
+        y1 = h - 1;
+    float alpha = s - x0;
+    float beta = t - y0;
+    vec3 a = mix(tex.texel(level, x0, y0), tex.texel(level, x1, y0), alpha);
+    vec3 b = mix(tex.texel(level, x0, y1), tex.texel(level, x1, y1), alpha);
+    return mix(a, b, beta);
+}
+
+// Linear interpolation between the bilinear values of two mip levels
+template<typename T> vec3 filterTrilinear(const T& tex, float lod, const vec2& texcoord)
+{
+    int maxLevel = tex.levels() - 1;
+    if (lod <= 0.0f)
+        return filterBilinear(tex, 0, texcoord);
+    if (lod >= maxLevel)
+        return filterBilinear(tex, maxLevel, texcoord);
+    int level = lod;
+    return mix(filterBilinear(tex, level, texcoord), filterBilinear(tex, level + 1, texcoord), lod - level);
+}
+
+// Filter over the footprint given by the derivatives of the texture
+// coordinates in image x and y direction: up to maxAnisotropy trilinear
+// samples along the major axis of the footprint
+template<typename T> vec3 filterAnisotropic(const T& tex, const vec2& texcoord,
+        const vec2& dtdx, const vec2& dtdy, int maxAnisotropy = 8)
+{
+    // the axes of the footprint, in texels
+    vec2 size = vec2(tex.levelWidth(0), tex.levelHeight(0));
+    vec2 major = dtdx;
+    vec2 minor = dtdy;
+    float majorLength = length(dtdx * size);
+    float minorLength = length(dtdy * size);
+    if (majorLength < minorLength) {
+        std::swap(major, minor);
+        std::swap(majorLength, minorLength);
+    }
+    if (majorLength <= 1.0f)
+        return filterBilinear(tex, 0, texcoord);
+    // the number of samples along the major axis; the level of detail
+    // is chosen so that the samples cover the footprint without gaps
+    int samples = std::min(maxAnisotropy, int(std::ceil(majorLength / std::max(minorLength, 1e-6f))));
+    float lod = std::log2(std::max(majorLength / samples, minorLength));
+    if (samples == 1)
+        return filterTrilinear(tex, lod, texcoord);
+    vec3 sum = vec3(0.0f);
+    for (int i = 0; i < samples; i++)
+        sum += filterTrilinear(tex, lod, texcoord + ((i + 0.5f) / samples - 0.5f) * major);
+    return sum / float(samples);
+}
+
+// The texels of a level that contribute to texel i of the next coarser level
+// along one axis, and their weights. For even sizes, these are the two texels
+// 2i and 2i+1. For odd sizes n, the n texels are spread over the n/2 texels of
+// the coarser level with three taps each, so that every texel contributes
+// with the same total weight.
+inline int downsampleTaps(int n, int i, int* index, float* weight)
+{
+    if (n == 1) {
+        index[0] = 0;
+        weight[0] = 1.0f;
+        return 1;
+    }
+    if (n % 2 == 0) {
+        index[0] = 2 * i;
+        index[1] = 2 * i + 1;
+        weight[0] = weight[1] = 0.5f;
+        return 2;
+    }
+    int m = n / 2;
+    for (int k = 0; k < 3; k++)
+        index[k] = 2 * i + k;
+    weight[0] = float(m - i) / n;
+    weight[1] = float(m) / n;
+    weight[2] = float(i + 1) / n;
+    return 3;
+}
+
+// Build the next mip level from the given one with a box filter: 2x2 texels
+// for even sizes, and three weighted taps per axis for odd sizes (see
+// downsampleTaps()), so that no row or column is lost
+inline std::vector<vec3> downsample(const std::vector<vec3>& prev, int pw, int ph, int& w, int& h)
+{
+    w = std::max(1, pw / 2);
+    h = std::max(1, ph / 2);
+    std::vector<vec3> level(w * h);
+    for (int y = 0; y < h; y++) {
+        int iy[3], ix[3];
+        float wy[3], wx[3];
+        int ny = downsampleTaps(ph, y, iy, wy);
+        for (int x = 0; x < w; x++) {
+            int nx = downsampleTaps(pw, x, ix, wx);
+            vec3 sum(0.0f);
+            for (int j = 0; j < ny; j++)
+                for (int i = 0; i < nx; i++)
+                    sum += (wy[j] * wx[i]) * prev[iy[j] * pw + ix[i]];
+            level[y * w + x] = sum;
+        }
+    }
+    return level;
+}
@@ -25,19 +25,46 @@ public:
         return values[y * width + x];
     }
 
-    virtual vec3 value(const vec2& texcoord, float /* t */) const override
+    // the noise at lattice coordinates (x,y)
+    float noise(float x, float y) const
     {
-        float ix = std::floor(width * texcoord.x());
-        float iy = std::floor(height * texcoord.y());
-        float fx = fract(width * texcoord.x());
-        float fy = fract(height * texcoord.y());
+        float ix = std::floor(x);
+        float iy = std::floor(y);
+        float fx = fract(x);
+        float fy = fract(y);
         float sx = fx * fx * (3.0f - 2.0f * fx); // smoothstep function
         float sy = fy * fy * (3.0f - 2.0f * fy); // smoothstep function
         float a = mix(dot(value(ix + 0, iy + 0), vec2(fx - 0.0f, fy - 0.0f)),
                       dot(value(ix + 1, iy + 0), vec2(fx - 1.0f, fy - 0.0f)), sx);
         float b = mix(dot(value(ix + 0, iy + 1), vec2(fx - 0.0f, fy - 1.0f)),
                       dot(value(ix + 1, iy + 1), vec2(fx - 1.0f, fy - 1.0f)), sx);
-        float c = mix(a, b, sy);
-        return vec3(c);
+        return mix(a, b, sy);
+    }
+
+    virtual bool bakeable() const override
+    {
+        return true;
+    }
+
+    virtual vec3 value(const vec2& texcoord, float /* t */) const override
+    {
+        return vec3(noise(width * texcoord.x(), height * texcoord.y()));
+    }
+
+    // All octaves in one vectorized loop
+    virtual void octaves(const vec2& texcoord, float freq, int count, float /* t */, float* result) const override
+    {
+        #pragma omp simd
+        for (int i = 0; i < count; i++) {
+            float f = freq * float(1 << i);
+            result[i] = noise(width * (f * texcoord.x()), height * (f * texcoord.y()));
+        }
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(width);
+        hasher.add(height);
+        hasher.addArray(values.data(), values.size());
     }
 };
@@ -2,71 +2,297 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 #include "texture.hpp"
+#include "texture_filter.hpp"
 #include "math.hpp"
 
 #include "stb_image.h"
 
+// Storage formats for texels
+typedef enum {
+    TexelUnorm8,    // 8 bit per channel, decoded with a lookup table
+    TexelHalf,      // 16 bit floating point per channel
+    TexelFloat,     // 32 bit floating point per channel
+} TexelFormat;
+
+// Conversion between float and 16 bit floating point (IEEE 754 half precision),
+// with rounding to nearest even
+inline uint16_t floatToHalf(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t absX = x & 0x7fffffffu;
+    if (absX >= 0x7f800000u) // Inf or NaN
+        return sign | 0x7c00u | (absX > 0x7f800000u ? 0x200u : 0u);
+    if (absX >= 0x477ff000u) // overflow
+        return sign | 0x7c00u;
+    if (absX < 0x38800000u) { // subnormal half
+        if (absX < 0x33000000u)
+            return sign;
+        uint32_t mantissa = (absX & 0x7fffffu) | 0x800000u;
+        int shift = 126 - int(absX >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            half++;
+        return sign | half;
+    }
+    uint32_t half = (absX - 0x38000000u) >> 13;
+    uint32_t rest = absX & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++;
+    return sign | half;
+}
+
+inline float halfToFloat(uint16_t h)
+{
+    uint32_t sign = uint32_t(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1fu;
+    uint32_t mantissa = h & 0x3ffu;
+    uint32_t x;
+    if (exponent == 0x1fu) {
+        x = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent > 0) {
+        x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        x = sign;
+    } else {
+        // subnormal half: normalize
+        exponent = 113;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        x = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// The size of a texel in bytes
+inline int texelBytes(TexelFormat format, int channels)
+{
+    return channels * (format == TexelUnorm8 ? 1 : format == TexelHalf ? 2 : 4);
+}
+
+// Decode a texel from its storage format to linear RGB values
+inline vec3 decodeTexel(const unsigned char* data, TexelFormat format, int channels, const float* decodeTable)
+{
+    if (format == TexelUnorm8) {
+        return (channels == 1 ? vec3(decodeTable[data[0]])
+                : vec3(decodeTable[data[0]], decodeTable[data[1]], decodeTable[data[2]]));
+    } else if (format == TexelHalf) {
+        uint16_t p[3];
+        std::memcpy(p, data, 2 * channels);
+        return (channels == 1 ? vec3(halfToFloat(p[0]))
+                : vec3(halfToFloat(p[0]), halfToFloat(p[1]), halfToFloat(p[2])));
+    } else {
+        float p[3];
+        std::memcpy(p, data, 4 * channels);
+        return (channels == 1 ? vec3(p[0]) : vec3(p[0], p[1], p[2]));
+    }
+}
+
+// An image texture. The texels are stored with the channel count of the image
+// file (one channel for gray images, three for color), and for LDR images
+// with 8 bit per channel; they are decoded to linear values through a lookup
+// table. HDR images use half floats, or floats if their values do not fit.
+// A mip pyramid is built when the texture is created, so that filteredValue()
+// can filter over the footprint of a pixel. Different threads may load images
+// at the same time.
 class TextureImage : public Texture
 {
 public:
     int width, height;
-    std::vector<vec3> img;
+    int channels;                   // 1 (gray) or 3 (RGB)
+    TexelFormat format;
+    float decodeTable[256];         // TexelUnorm8: linear value of each 8 bit value
+    std::vector<int> widths, heights;
+    std::vector<std::vector<unsigned char>> levelData; // per mip level: the texels
 
     TextureImage(const std::string& fileName, bool linearizeLDR = true)
     {
-        stbi_ldr_to_hdr_gamma(linearizeLDR ? 2.2f : 1.0f);
-        stbi_set_flip_vertically_on_load(1);
+        stbi_set_flip_vertically_on_load_thread(1);
         int w, h, n;
-        float* data = stbi_loadf(fileName.c_str(), &w, &h, &n, 3);
-        if (!data) {
+        if (!stbi_info(fileName.c_str(), &w, &h, &n)) {
             fprintf(stderr, "cannot load texture %s\n", fileName.c_str());
             abort();
         }
         width = w;
         height = h;
-        img.resize(width * height);
-        for (int i = 0; i < width * height; i++)
-            img[i] = vec3(data[3*i+0], data[3*i+1], data[3*i+2]);
-        stbi_image_free(data);
+        // stb_image reports 2 channels for gray + alpha and 4 for RGB + alpha;
+        // it has no two-channel color images. The renderer does not use alpha,
+        // so gray + alpha images are stored as one channel (not expanded to
+        // RGB) and no two-channel format is needed.
+        channels = (n <= 2 ? 1 : 3);
+        initDecodeTable(linearizeLDR);
+        if (!stbi_is_hdr(fileName.c_str())) {
+            // stb_image reduces 16 bit images to 8 bit anyway
+            format = TexelUnorm8;
+            unsigned char* data = stbi_load(fileName.c_str(), &w, &h, &n, channels);
+            if (!data) {
+                fprintf(stderr, "cannot load texture %s\n", fileName.c_str());
+                abort();
+            }
+            levelData.push_back(std::vector<unsigned char>(data, data + size_t(width) * height * channels));
+            stbi_image_free(data);
+        } else {
+            float* data = stbi_loadf(fileName.c_str(), &w, &h, &n, channels);
+            if (!data) {
+                fprintf(stderr, "cannot load texture %s\n", fileName.c_str());
+                abort();
+            }
+            std::vector<vec3> img(width * height);
+            for (int i = 0; i < width * height; i++)
+                img[i] = (channels == 1 ? vec3(data[i]) : vec3(data[3*i+0], data[3*i+1], data[3*i+2]));
+            stbi_image_free(data);
+            format = (fitsHalf(img) ? TexelHalf : TexelFloat);
+            levelData.push_back(encode(img));
+        }
+        widths.assign(1, width);
+        heights.assign(1, height);
+        buildMipmaps();
     }
 
-    TextureImage(const std::vector<vec3>& img, int w, int h)
-        : width(w), height(h), img(img)
+    TextureImage(const std::vector<vec3>& img, int w, int h, TexelFormat fmt = TexelFloat)
+        : width(w), height(h), channels(3), format(fmt)
     {
+        initDecodeTable(false);
+        levelData.push_back(encode(img));
+        widths.assign(1, width);
+        heights.assign(1, height);
+        buildMipmaps();
+    }
+
+    // The decode table gives the same values as stb_image's conversion of
+    // 8 bit images to float (without using its global gamma setting)
+    void initDecodeTable(bool linearize)
+    {
+        for (int i = 0; i < 256; i++)
+            decodeTable[i] = (linearize ? float(std::pow(i / 255.0f, 2.2f)) : i / 255.0f);
+    }
+
+    static bool fitsHalf(const std::vector<vec3>& img)
+    {
+        for (size_t i = 0; i < img.size(); i++)
+            for (int c = 0; c < 3; c++)
+                if (!(std::abs(img[i][c]) <= 65504.0f))
+                    return false;
+        return true;
+    }
+
+    // the 8 bit value whose decoded value is closest to v
+    unsigned char encodeUnorm8(float v) const
+    {
+        int i = std::lower_bound(decodeTable, decodeTable + 256, v) - decodeTable;
+        if (i == 256 || (i > 0 && v - decodeTable[i - 1] < decodeTable[i] - v))
+            i--;
+        return i;
+    }
+
+    // Convert texels to the storage format
+    std::vector<unsigned char> encode(const std::vector<vec3>& img) const
+    {
+        std::vector<unsigned char> data(img.size() * texelBytes(format, channels));
+        for (size_t i = 0; i < img.size(); i++) {
+            for (int c = 0; c < channels; c++) {
+                size_t j = i * channels + c;
+                if (format == TexelUnorm8) {
+                    data[j] = encodeUnorm8(img[i][c]);
+                } else if (format == TexelHalf) {
+                    uint16_t h = floatToHalf(img[i][c]);
+                    std::memcpy(&data[2 * j], &h, 2);
+                } else {
+                    std::memcpy(&data[4 * j], &img[i][c], 4);
+                }
+            }
+        }
+        return data;
+    }
+
+    // Build the mip levels from the linear texel values; 8 bit levels are
+    // encoded with the decode table again
+    void buildMipmaps()
+    {
+        std::vector<vec3> prev(width * height);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                prev[y * width + x] = texel(0, x, y);
+        while (widths.back() > 1 || heights.back() > 1) {
+            int w, h;
+            std::vector<vec3> level = downsample(prev, widths.back(), heights.back(), w, h);
+            widths.push_back(w);
+            heights.push_back(h);
+            levelData.push_back(encode(level));
+            prev = std::move(level);
+        }
+    }
+
+    // texel memory in bytes, including the mip levels
+    size_t memory() const
+    {
+        size_t bytes = 0;
+        for (size_t l = 0; l < levelData.size(); l++)
+            bytes += levelData[l].size();
+        return bytes;
+    }
+
+    int levels() const
+    {
+        return widths.size();
+    }
+
+    int levelWidth(int level) const
+    {
+        return widths[level];
+    }
+
+    int levelHeight(int level) const
+    {
+        return heights[level];
+    }
+
+    vec3 texel(int level, int x, int y) const
+    {
+        size_t i = size_t(y) * widths[level] + x;
+        return decodeTexel(levelData[level].data() + i * texelBytes(format, channels), format, channels, decodeTable);
     }
 
     vec3 value(int x, int y) const
     {
-        return img[y * width + x];
+        return texel(0, x, y);
     }
 
     virtual vec3 value(const vec2& texcoord, float /* time */) const override
     {
-        // use only the fractional part of the texture coordinate so that
-        // it is in [0,1) and no over- or underflow can occur
-        float u = fract(texcoord.x());
-        float v = fract(texcoord.y());
-        // bilinear interpolation
-        float s = u * width - 0.5f;
-        if (s < 0.0f)
-            s = 0.0f;
-        float t = v * height - 0.5f;
-        if (t < 0.0f)
-            t = 0.0f;
-        int x0 = s;
-        int y0 = t;
-        int x1 = x0 + 1;
-        if (x1 >= width)
-            x1 = width - 1;
-        int y1 = y0 + 1;
-        if (y1 >= height)
-            y1 = height - 1;
-        float alpha = s - x0;
-        float beta = t - y0;
-        vec3 a = mix(value(x0, y0), value(x1, y0), alpha);
-        vec3 b = mix(value(x0, y1), value(x1, y1), alpha);
-        return mix(a, b, beta);
+        return filterBilinear(*this, 0, texcoord);
+    }
+
+    virtual vec3 filteredValue(const vec2& texcoord, const vec2& dtdx, const vec2& dtdy, float /* time */) const override
+    {
+        return filterAnisotropic(*this, texcoord, dtdx, dtdy);
+    }
+
+    virtual int texelWidth() const override
+    {
+        return width;
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.add(width);
+        hasher.add(height);
+        hasher.add(channels);
+        hasher.add(format);
+        hasher.add(decodeTable);
+        hasher.addArray(levelData[0].data(), levelData[0].size());
     }
 };
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include <sys/stat.h>
+
+#include "texture.hpp"
+
+// Identifies a texture: the contents of its image file and the parameters
+// used to decode it
+class TextureKey
+{
+public:
+    int content;        // see TextureRegistry; -1 if the file cannot be read
+    bool linearizeLDR;
+    float bumpFactor;
+
+    bool operator<(const TextureKey& k) const
+    {
+        return std::tie(content, linearizeLDR, bumpFactor) < std::tie(k.content, k.linearizeLDR, k.bumpFactor);
+    }
+};
+
+// Scene-wide registry of imported textures, so that an image is decoded and
+// stored only once however it is referenced: from several imports, through
+// different relative paths, or as a copy in another file. Files are known by
+// their canonical path; a file that was seen before with the same size and
+// modification time is not read again. Files with equal size are compared by
+// a hash of their contents, which is only computed for such files.
+class TextureRegistry
+{
+public:
+    class File
+    {
+    public:
+        off_t size;
+        time_t mtime;
+        bool hashed;
+        uint64_t hash;
+        int content;    // files with equal contents have the same number
+    };
+
+    std::map<std::string, File> files;      // by canonical path
+    std::map<TextureKey, Texture*> textures;
+    int contents;                           // number of different file contents
+    size_t hashedFiles;
+
+    TextureRegistry() : contents(0), hashedFiles(0)
+    {
+    }
+
+    static bool hashFile(const std::string& fileName, uint64_t& hash)
+    {
+        FILE* f = fopen(fileName.c_str(), "rb");
+        if (!f)
+            return false;
+        hash = 0xcbf29ce484222325u;
+        std::vector<unsigned char> buf(1 << 16);
+        size_t n;
+        while ((n = fread(buf.data(), 1, buf.size(), f)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                hash ^= buf[i];
+                hash *= 0x100000001b3u;
+            }
+        }
+        bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    }
+
+    bool hashFile(const std::string& path, File& file)
+    {
+        if (!file.hashed) {
+            if (!hashFile(path, file.hash))
+                return false;
+            file.hashed = true;
+            hashedFiles++;
+        }
+        return true;
+    }
+
+    // Get the key for an image file decoded with the given parameters
+    TextureKey key(const std::string& fileName, bool linearizeLDR, float bumpFactor)
+    {
+        TextureKey k { -1, linearizeLDR, bumpFactor > 0.0f ? bumpFactor : -1.0f };
+        char* canonical = realpath(fileName.c_str(), nullptr);
+        struct stat st;
+        if (!canonical || stat(canonical, &st) != 0) {
+            free(canonical);
+            return k;
+        }
+        std::string path = canonical;
+        free(canonical);
+        auto it = files.find(path);
+        if (it != files.end() && it->second.size == st.st_size && it->second.mtime == st.st_mtime) {
+            k.content = it->second.content;
+            return k;
+        }
+        File file { st.st_size, st.st_mtime, false, 0, -1 };
+        for (auto jt = files.begin(); jt != files.end() && file.content < 0; jt++) {
+            if (jt->first == path || jt->second.size != file.size)
+                continue;
+            if (!hashFile(path, file) || !hashFile(jt->first, jt->second))
+                break;
+            if (file.hash == jt->second.hash)
+                file.content = jt->second.content;
+        }
+        if (file.content < 0)
+            file.content = contents++;
+        files[path] = file;
+        k.content = file.content;
+        return k;
+    }
+
+    Texture* find(const TextureKey& k) const
+    {
+        auto it = textures.find(k);
+        return (k.content >= 0 && it != textures.end() ? it->second : nullptr);
+    }
+
+    void add(const TextureKey& k, Texture* tex)
+    {
+        if (k.content >= 0)
+            textures.insert(std::make_pair(k, tex));
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "texture.hpp"
+#include "texture_compiler.hpp"
 
 class TextureTransformer : public Texture
 {
@@ -17,4 +18,39 @@ public:
     {
         return tex->value(factor * texcoord + offset, t);
     }
+
+    virtual vec3 filteredValue(const vec2& texcoord, const vec2& dtdx, const vec2& dtdy, float t) const override
+    {
+        return tex->filteredValue(factor * texcoord + offset, factor * dtdx, factor * dtdy, t);
+    }
+
+    // Constants are not transformed, the identity is dropped, and a chain of
+    // transformers is merged into one
+    virtual const Texture* compile(TextureCompiler& compiler) const override
+    {
+        const Texture* c = compiler.compile(tex);
+        if (c->isConstant)
+            return c;
+        vec2 f = factor;
+        vec2 o = offset;
+        const TextureTransformer* inner = dynamic_cast<const TextureTransformer*>(c);
+        if (inner) {
+            // inner(f * tc + o) = inner->tex(inner->factor * (f * tc + o) + inner->offset)
+            c = inner->tex;
+            o = inner->factor * o + inner->offset;
+            f = inner->factor * f;
+        }
+        if (f == vec2(1.0f) && o == vec2(0.0f))
+            return c;
+        if (c == tex && !inner)
+            return this;
+        return compiler.add(new TextureTransformer(c, f, o));
+    }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addObject(tex);
+        hasher.add(factor);
+        hasher.add(offset);
+    }
 };
@@ -1,19 +1,65 @@
 #pragma once
 
 #include <vector>
+#include <cmath>
 
 #include "texture.hpp"
 #include "math.hpp"
 
+// Worley noise: the distances to the nearest, second nearest and third
+// nearest of a set of random points in the unit square, which is repeated
+// periodically. The points are sorted into a grid of cells, so that only the
+// cells around a texture coordinate need to be checked.
 class TextureWorleyNoise : public Texture
 {
 public:
     std::vector<vec2> points;
+    int gridSize;                       // number of cells per dimension
+    std::vector<int> cellStart;         // per cell: first index into cellPoints; one more entry at the end
+    std::vector<vec2> cellPoints;       // the points, sorted by cell
 
     TextureWorleyNoise(int n, Prng& prng) : points(n)
     {
         for (int i = 0; i < n; i++)
             points[i] = vec2(prng.in01(), prng.in01());
+        // about two points per cell
+        gridSize = std::max(1, int(std::sqrt(n / 2.0f)));
+        std::vector<int> cells(n);
+        cellStart.assign(gridSize * gridSize + 1, 0);
+        for (int i = 0; i < n; i++) {
+            cells[i] = cell(points[i].y()) * gridSize + cell(points[i].x());
+            cellStart[cells[i] + 1]++;
+        }
+        for (int c = 0; c < gridSize * gridSize; c++)
+            cellStart[c + 1] += cellStart[c];
+        cellPoints.resize(n);
+        std::vector<int> next(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < n; i++)
+            cellPoints[next[cells[i]]++] = points[i];
+    }
+
+    int cell(float x) const
+    {
+        return std::min(int(x * gridSize), gridSize - 1);
+    }
+
+    static void insert(float d, float& d1, float& d2, float& d3)
+    {
+        if (d < d1) {
+            d3 = d2;
+            d2 = d1;
+            d1 = d;
+        } else if (d < d2) {
+            d3 = d2;
+            d2 = d;
+        } else if (d < d3) {
+            d3 = d;
+        }
+    }
+
+    virtual bool bakeable() const override
+    {
+        return true;
     }
 
     virtual vec3 value(const vec2& texcoord, float /* t */) const override
@@ -22,28 +68,45 @@ public:
         float d1 = std::numeric_limits<float>::max();
         float d2 = std::numeric_limits<float>::max();
         float d3 = std::numeric_limits<float>::max();
+        int cx = cell(uv.x());
+        int cy = cell(uv.y());
+        float cellSize = 1.0f / gridSize;
+        // Check rings of cells around the cell of uv until no unchecked point
+        // can be closer than the third nearest point found so far. Cells
+        // outside the unit square refer to the repeated points.
+        for (int r = 0; 2 * r + 1 < gridSize; r++) {
+            for (int y = cy - r; y <= cy + r; y++) {
+                int step = (y == cy - r || y == cy + r ? 1 : 2 * r);
+                for (int x = cx - r; x <= cx + r; x += step) {
+                    int tileX = (x < 0 ? -1 : x >= gridSize ? 1 : 0);
+                    int tileY = (y < 0 ? -1 : y >= gridSize ? 1 : 0);
+                    int c = (y - tileY * gridSize) * gridSize + (x - tileX * gridSize);
+                    for (int i = cellStart[c]; i < cellStart[c + 1]; i++)
+                        insert(length(uv - (cellPoints[i] + vec2(tileX, tileY))), d1, d2, d3);
+                }
+            }
+            float border = std::min(
+                    std::min(uv.x() - (cx - r) * cellSize, (cx + r + 1) * cellSize - uv.x()),
+                    std::min(uv.y() - (cy - r) * cellSize, (cy + r + 1) * cellSize - uv.y()));
+            if (d3 <= border)
+                return vec3(d1, d2, d3);
+        }
+        // The rings would wrap around: check all points and their repetitions
+        d1 = d2 = d3 = std::numeric_limits<float>::max();
         for (size_t i = 0; i < points.size(); i++) {
-#if 0
-            float d = length(uv - points[i]);
-#else
             float d = std::numeric_limits<float>::max();
             for (int r = -1; r <= +1; r++) {
                 for (int c = -1; c <= +1; c++) {
                     d = std::min(d, length(uv - (points[i] + vec2(c, r))));
                 }
             }
-#endif
-            if (d < d1) {
-                d3 = d2;
-                d2 = d1;
-                d1 = d;
-            } else if (d < d2) {
-                d3 = d2;
-                d2 = d;
-            } else if (d < d3) {
-                d3 = d;
-            }
+            insert(d, d1, d2, d3);
         }
         return vec3(d1, d2, d3);
     }
+
+    virtual void hash(Hasher& hasher) const override
+    {
+        hasher.addArray(points.data(), points.size());
+    }
 };
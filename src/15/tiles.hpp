@@ -0,0 +1,281 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+typedef enum {
+    TileOrderScanline,  // row by row
+    TileOrderMorton,    // Z-order curve
+    TileOrderHilbert,   // Hilbert curve
+} TileOrder;
+
+class Tile
+{
+public:
+    int x, y;           // lower left pixel
+    int width, height;  // size in pixels; smaller than the tile size at the image border
+    int view;           // the image that the tile belongs to
+};
+
+// Distributes the tiles of one or more images to threads. The tiles are sorted along a
+// space filling curve so that consecutive tiles are close to each other, which
+// keeps the BVH nodes and textures a thread needs in its caches. Each thread
+// starts with a contiguous range of tiles; a thread that runs out of tiles
+// steals the second half of the largest remaining range of another thread.
+// The scheduler also measures how busy each thread is, to show load imbalance.
+class TileScheduler
+{
+public:
+    // a range [begin,end) of tile indices, packed into one atomic value;
+    // each on its own cache line
+    class alignas(64) Range
+    {
+    public:
+        std::atomic<uint64_t> value;
+
+        Range() : value(0)
+        {
+        }
+
+        static uint64_t pack(uint32_t begin, uint32_t end)
+        {
+            return (uint64_t(begin) << 32) | end;
+        }
+
+        static uint32_t begin(uint64_t v)
+        {
+            return v >> 32;
+        }
+
+        static uint32_t end(uint64_t v)
+        {
+            return uint32_t(v);
+        }
+    };
+
+    class alignas(64) ThreadStats
+    {
+    public:
+        double busy;        // seconds spent rendering tiles
+        size_t tiles;       // number of rendered tiles
+        size_t steals;      // number of successful steals
+
+        ThreadStats() : busy(0.0), tiles(0), steals(0)
+        {
+        }
+    };
+
+    int tileSize;
+    TileOrder order;
+    std::vector<Tile> tiles;
+    std::vector<Range> ranges;
+    std::vector<ThreadStats> stats;
+    double wallTime;    // seconds spent in passes
+    std::chrono::steady_clock::time_point passStart;
+
+    static int maxThreads()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    static int threadNum()
+    {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    static uint32_t mortonIndex(uint32_t x, uint32_t y)
+    {
+        uint32_t d = 0;
+        for (int b = 0; b < 16; b++)
+            d |= (((x >> b) & 1) << (2 * b)) | (((y >> b) & 1) << (2 * b + 1));
+        return d;
+    }
+
+    // index of (x,y) on the Hilbert curve filling an n x n grid (n a power of 2)
+    static uint32_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y)
+    {
+        uint32_t d = 0;
+        for (uint32_t s = n / 2; s > 0; s /= 2) {
+            uint32_t rx = (x & s) > 0;
+            uint32_t ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    TileScheduler(int tileSize, TileOrder order) :
+        tileSize(tileSize), order(order), ranges(maxThreads()), stats(maxThreads()), wallTime(0.0)
+    {
+    }
+
+    TileScheduler(int width, int height, int tileSize, TileOrder order) :
+        TileScheduler(tileSize, order)
+    {
+        addImage(width, height, 0);
+    }
+
+    // Add the tiles of an image; the tiles of each image are consecutive, so
+    // that threads mostly work on one image at a time
+    void addImage(int width, int height, int view)
+    {
+        addRegion(width, 0, 0, width, height, view);
+    }
+
+    // Add the tiles of a rectangular region of an image, e.g. a crop window.
+    // If a mask with one value per pixel of the image is given, tiles that
+    // contain no pixel with a nonzero mask value are left out.
+    void addRegion(int imageWidth, int x0, int y0, int width, int height, int view,
+            const std::vector<unsigned char>& mask = {})
+    {
+        int tilesX = (width + tileSize - 1) / tileSize;
+        int tilesY = (height + tileSize - 1) / tileSize;
+        uint32_t n = 1;
+        while (n < uint32_t(std::max(tilesX, tilesY)))
+            n *= 2;
+        std::vector<std::pair<uint32_t, Tile>> sortedTiles;
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                Tile t;
+                t.x = x0 + tx * tileSize;
+                t.y = y0 + ty * tileSize;
+                t.width = std::min(tileSize, x0 + width - t.x);
+                t.height = std::min(tileSize, y0 + height - t.y);
+                t.view = view;
+                bool selected = mask.empty();
+                for (int y = t.y; y < t.y + t.height && !selected; y++)
+                    for (int x = t.x; x < t.x + t.width && !selected; x++)
+                        selected = mask[y * imageWidth + x];
+                if (!selected)
+                    continue;
+                uint32_t key = (order == TileOrderMorton ? mortonIndex(tx, ty)
+                        : order == TileOrderHilbert ? hilbertIndex(n, tx, ty)
+                        : ty * tilesX + tx);
+                sortedTiles.push_back(std::make_pair(key, t));
+            }
+        }
+        std::stable_sort(sortedTiles.begin(), sortedTiles.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (size_t i = 0; i < sortedTiles.size(); i++)
+            tiles.push_back(sortedTiles[i].second);
+    }
+
+    // Distribute all tiles to the threads for a new pass
+    void startPass()
+    {
+        size_t threads = ranges.size();
+        for (size_t t = 0; t < threads; t++) {
+            uint32_t begin = t * tiles.size() / threads;
+            uint32_t end = (t + 1) * tiles.size() / threads;
+            ranges[t].value.store(Range::pack(begin, end));
+        }
+        passStart = std::chrono::steady_clock::now();
+    }
+
+    void finishPass()
+    {
+        wallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count();
+    }
+
+    // Get the next tile for the calling thread. Returns false when all tiles
+    // of the pass are taken.
+    bool next(Tile& tile)
+    {
+        int thread = threadNum();
+        if (thread < int(ranges.size())) {
+            // take the first tile of the own range
+            std::atomic<uint64_t>& own = ranges[thread].value;
+            for (;;) {
+                uint64_t v = own.load();
+                while (Range::begin(v) < Range::end(v)) {
+                    if (own.compare_exchange_weak(v, Range::pack(Range::begin(v) + 1, Range::end(v)))) {
+                        tile = tiles[Range::begin(v)];
+                        return true;
+                    }
+                }
+                // steal the second half of the largest range of another thread
+                uint32_t begin, end;
+                if (!steal(thread, begin, end))
+                    return false;
+                stats[thread].steals++;
+                own.store(Range::pack(begin, end));
+            }
+        } else {
+            // threads without own range only steal single tiles
+            uint32_t begin, end;
+            if (!steal(thread, begin, end, true))
+                return false;
+            tile = tiles[begin];
+            return true;
+        }
+    }
+
+    bool steal(int thief, uint32_t& begin, uint32_t& end, bool single = false)
+    {
+        for (;;) {
+            int victim = -1;
+            uint32_t largest = 0;
+            for (int t = 0; t < int(ranges.size()); t++) {
+                uint64_t v = ranges[t].value.load();
+                uint32_t remaining = Range::end(v) - std::min(Range::begin(v), Range::end(v));
+                if (t != thief && remaining > largest) {
+                    largest = remaining;
+                    victim = t;
+                }
+            }
+            if (victim < 0)
+                return false;
+            uint64_t v = ranges[victim].value.load();
+            uint32_t b = Range::begin(v);
+            uint32_t e = Range::end(v);
+            if (b >= e)
+                continue;
+            uint32_t half = (single ? 1 : (e - b + 1) / 2);
+            if (ranges[victim].value.compare_exchange_strong(v, Range::pack(b, e - half))) {
+                begin = e - half;
+                end = e;
+                return true;
+            }
+        }
+    }
+
+    void addStats(double busy)
+    {
+        int thread = threadNum();
+        if (thread < int(stats.size())) {
+            stats[thread].busy += busy;
+            stats[thread].tiles++;
+        }
+    }
+
+    void report(FILE* f = stderr) const
+    {
+        fprintf(f, "Tile scheduling: %zu tiles per pass, %.1fs in passes\n", tiles.size(), wallTime);
+        for (size_t t = 0; t < stats.size(); t++) {
+            fprintf(f, "  thread %2zu: %6zu tiles, %4zu steals, %5.1f%% busy\n", t,
+                    stats[t].tiles, stats[t].steals, wallTime > 0.0 ? 100.0 * stats[t].busy / wallTime : 0.0);
+        }
+    }
+};